@@ -1,31 +1,45 @@
 #include "Actor.h"
 #include "StudentWorld.h"
 #include "GameConstants.h"
+#include "Proximity.h"
+#include "BinaryIO.h"
+#include "StateHash.h"
 #include <algorithm>
+#include <initializer_list>
 #include <vector>
 using namespace std;
 
 
 Actor::Actor(int imageID, int startX, int startY, Direction dir, double size, unsigned int depth, StudentWorld* world_ptr, int initialHP, bool initiallyVisible)
-    : GraphObject(imageID, startX, startY, dir, size, depth),
-      world(world_ptr), alive(true), hp(initialHP) {
+    : GraphObject(imageID, startX, startY, dir, size, depth,
+                  world_ptr != nullptr ? &world_ptr->getGraphObjectRegistry() : nullptr),
+      world(world_ptr), alive(true), hp(initialHP), hashTracked(false) {
     if (initiallyVisible) {
         setVisibleWithCheck(true);
     }
 }
 
+Actor::Actor(const Actor& other, StudentWorld* world_ptr)
+    : GraphObject(other, &world_ptr->getGraphObjectRegistry()),
+      world(world_ptr), alive(other.alive), hp(other.hp), hashTracked(false) {
+}
+
 Actor::~Actor() {
+    setHashTracked(false);
 }
 
 bool Actor::annoy(int damagePoints) {
     if (!isAlive()) return false;
 
+    unsigned long long before = hashTermIfTracked();
     hp -= damagePoints;
     if (hp <= 0) {
         hp = 0;
-        setDead();
+        alive = false;
+        stateChanged(before);
         return true;
     }
+    stateChanged(before);
     return false;
 }
 
@@ -34,7 +48,16 @@ bool Actor::isAlive() const {
 }
 
 void Actor::setDead() {
+    unsigned long long before = hashTermIfTracked();
     alive = false;
+    stateChanged(before);
+}
+
+void Actor::revive(int newHp) {
+    unsigned long long before = hashTermIfTracked();
+    alive = true;
+    hp = newHp;
+    stateChanged(before);
 }
 
 int Actor::getHP() const {
@@ -42,11 +65,13 @@ int Actor::getHP() const {
 }
 
 void Actor::setHP(int newHp) {
+    unsigned long long before = hashTermIfTracked();
     hp = newHp;
     if (hp <= 0 && alive) {
         hp = 0;
-        setDead();
+        alive = false;
     }
+    stateChanged(before);
 }
 
 StudentWorld* Actor::getWorld() const {
@@ -60,7 +85,96 @@ bool Actor::canPickUpGold() const { return false; }
 bool Actor::isDamageable() const { return false; }
 
 void Actor::setVisibleWithCheck(bool visible_status) {
+    unsigned long long before = hashTermIfTracked();
     GraphObject::setVisible(visible_status);
+    stateChanged(before);
+}
+
+void Actor::moveTo(int x, int y) {
+    unsigned long long before = hashTermIfTracked();
+    GraphObject::moveTo(x, y);
+    stateChanged(before);
+}
+
+void Actor::teleportTo(int x, int y) {
+    unsigned long long before = hashTermIfTracked();
+    GraphObject::teleportTo(x, y);
+    stateChanged(before);
+}
+
+void Actor::setDirection(Direction dir) {
+    unsigned long long before = hashTermIfTracked();
+    GraphObject::setDirection(dir);
+    stateChanged(before);
+}
+
+unsigned long long Actor::getStateHashTerm() const {
+    return finalizeHash(static_cast<unsigned long long>(getID()) << 48 |
+                        static_cast<unsigned long long>(getX() & 0xFF) << 40 |
+                        static_cast<unsigned long long>(getY() & 0xFF) << 32 |
+                        static_cast<unsigned long long>(getDirection()) << 24 |
+                        static_cast<unsigned long long>(isVisible()) << 21 |
+                        static_cast<unsigned long long>(alive) << 20 |
+                        static_cast<unsigned long long>(hp & 0xFFFFF));
+}
+
+unsigned long long Actor::hashTermIfTracked() const {
+    return hashTracked ? getStateHashTerm() : 0;
+}
+
+void Actor::setHashTracked(bool tracked) {
+    if (tracked == hashTracked) return;
+    hashTracked = tracked;
+    unsigned long long term = getStateHashTerm();
+    world->actorHashChanged(tracked ? 0 : term, tracked ? term : 0);
+}
+
+void Actor::stateChanged(unsigned long long termBefore) {
+    if (hashTracked) {
+        world->actorHashChanged(termBefore, getStateHashTerm());
+    }
+}
+
+void Actor::saveState(ByteWriter& out) const {
+    out.writeByte(static_cast<unsigned char>(getDirection()));
+    out.writeBool(isVisible());
+    out.writeBool(alive);
+    out.writeInt(hp);
+}
+
+bool Actor::loadState(ByteReader& in) {
+    unsigned char dir;
+    bool visible, aliveValue;
+    int hpValue;
+    if (!in.readByte(dir) || dir > right || !in.readBool(visible) || !in.readBool(aliveValue) || !in.readInt(hpValue)) {
+        return false;
+    }
+    setDirection(static_cast<Direction>(dir));
+    setVisibleWithCheck(visible);
+    unsigned long long before = hashTermIfTracked();
+    alive = aliveValue;
+    hp = hpValue;
+    stateChanged(before);
+    return true;
+}
+
+// Constructors run their usual side effects here (a boulder clears the earth under it, a protester
+// draws its first wander from the world's generator), so the world restores those afterwards.
+Actor* Actor::createForRestore(int kind, StudentWorld* world_ptr, int x, int y) {
+    Actor* actor = nullptr;
+    switch (kind) {
+        case KIND_BOULDER: return new Boulder(world_ptr, x, y);
+        case KIND_SQUIRT: return new Squirt(world_ptr, x, y, right);
+        case KIND_BARREL: return new BarrelOfOil(world_ptr, x, y);
+        case KIND_GOLD: return new Gold(world_ptr, x, y);
+        case KIND_SONAR_KIT: return new SonarKit(world_ptr, x, y, 0);
+        case KIND_WATER_POOL: return new WaterPool(world_ptr, x, y, 0);
+        case KIND_REGULAR_PROTESTER: actor = new RegularProtester(world_ptr, 0); break;
+        case KIND_HARDCORE_PROTESTER: actor = new HardcoreProtester(world_ptr, 0); break;
+        default: return nullptr;
+    }
+    actor->teleportTo(x, y);
+    return actor;
 }
 
 
@@ -71,7 +185,51 @@ TunnelMan::TunnelMan(StudentWorld* worldPtr)
       squirts(5), sonar(1), gold(0) {
 }
 
+TunnelMan::TunnelMan(const TunnelMan& other, StudentWorld* world_ptr)
+    : Actor(other, world_ptr), squirts(other.squirts), sonar(other.sonar), gold(other.gold) {
+}
+
+// Untracked here, while getStateHashTerm() still includes the inventory.
 TunnelMan::~TunnelMan() {
+    setHashTracked(false);
+}
+
+Actor::Kind TunnelMan::getKind() const { return KIND_TUNNELMAN; }
+
+Actor* TunnelMan::clone(StudentWorld* world_ptr) const { return new TunnelMan(*this, world_ptr); }
+
+void TunnelMan::saveState(ByteWriter& out) const {
+    Actor::saveState(out);
+    out.writeInt(squirts);
+    out.writeInt(sonar);
+    out.writeInt(gold);
+}
+
+bool TunnelMan::loadState(ByteReader& in) {
+    if (!Actor::loadState(in)) return false;
+    unsigned long long before = hashTermIfTracked();
+    bool ok = in.readInt(squirts) && in.readInt(sonar) && in.readInt(gold);
+    stateChanged(before);
+    return ok;
+}
+
+unsigned long long TunnelMan::getStateHashTerm() const {
+    return Actor::getStateHashTerm() +
+           finalizeHash(static_cast<unsigned long long>(squirts & 0xFFFFF) << 40 |
+                        static_cast<unsigned long long>(sonar & 0xFFFFF) << 20 |
+                        static_cast<unsigned long long>(gold & 0xFFFFF));
+}
+
+void TunnelMan::reset() {
+    revive(10);
+    unsigned long long before = hashTermIfTracked();
+    squirts = 5;
+    sonar = 1;
+    gold = 0;
+    stateChanged(before);
+    setDirection(right);
+    teleportTo(30, 60);
+    setVisibleWithCheck(true);
 }
 
 void TunnelMan::doSomething() {
@@ -186,11 +344,15 @@ bool TunnelMan::isDamageable() const {
 }
 
 void TunnelMan::addGold(int amount) {
+    unsigned long long before = hashTermIfTracked();
     gold += amount;
+    stateChanged(before);
 }
 
 void TunnelMan::useGold() {
+    unsigned long long before = hashTermIfTracked();
     if (gold > 0) gold--;
+    stateChanged(before);
 }
 
 int TunnelMan::getGoldCount() const {
@@ -198,11 +360,15 @@ int TunnelMan::getGoldCount() const {
 }
 
 void TunnelMan::addWater(int amount) {
+    unsigned long long before = hashTermIfTracked();
     squirts += amount;
+    stateChanged(before);
 }
 
 void TunnelMan::useSquirt() {
+    unsigned long long before = hashTermIfTracked();
     if (squirts > 0) squirts--;
+    stateChanged(before);
 }
 
 int TunnelMan::getWaterCount() const {
@@ -210,11 +376,15 @@ int TunnelMan::getWaterCount() const {
 }
 
 void TunnelMan::addSonar(int amount) {
+    unsigned long long before = hashTermIfTracked();
     sonar += amount;
+    stateChanged(before);
 }
 
 void TunnelMan::useSonar() {
+    unsigned long long before = hashTermIfTracked();
     if (sonar > 0) sonar--;
+    stateChanged(before);
 }
 
 int TunnelMan::getSonarCount() const {
@@ -230,8 +400,16 @@ Earth::Earth(StudentWorld* world_ptr, int startX, int startY)
     : Actor(TID_EARTH, startX, startY, right, 0.25, 3, world_ptr, 0, true) {
 }
 
+Earth::Earth(const Earth& other, StudentWorld* world_ptr)
+    : Actor(other, world_ptr) {
+}
+
 Earth::~Earth() {}
 
+Actor::Kind Earth::getKind() const { return KIND_EARTH; }
+
+Actor* Earth::clone(StudentWorld* world_ptr) const { return new Earth(*this, world_ptr); }
+
 void Earth::doSomething() {
 }
 
@@ -253,7 +431,40 @@ Boulder::Boulder(StudentWorld* world_ptr, int startX, int startY)
     clearEarth();
 }
 
-Boulder::~Boulder() {}
+Boulder::Boulder(const Boulder& other, StudentWorld* world_ptr)
+    : Actor(other, world_ptr), state(other.state), waitingTicks(other.waitingTicks) {
+}
+
+Boulder::~Boulder() {
+    setHashTracked(false);
+}
+
+Actor::Kind Boulder::getKind() const { return KIND_BOULDER; }
+
+Actor* Boulder::clone(StudentWorld* world_ptr) const { return new Boulder(*this, world_ptr); }
+
+void Boulder::saveState(ByteWriter& out) const {
+    Actor::saveState(out);
+    out.writeByte(static_cast<unsigned char>(state));
+    out.writeInt(waitingTicks);
+}
+
+bool Boulder::loadState(ByteReader& in) {
+    unsigned char stateValue;
+    if (!Actor::loadState(in) || !in.readByte(stateValue) || stateValue > static_cast<unsigned char>(State::FALLING)) {
+        return false;
+    }
+    unsigned long long before = hashTermIfTracked();
+    state = static_cast<State>(stateValue);
+    bool ok = in.readInt(waitingTicks);
+    stateChanged(before);
+    return ok;
+}
+
+unsigned long long Boulder::getStateHashTerm() const {
+    return finalizeHash(Actor::getStateHashTerm() ^
+                        (static_cast<unsigned long long>(state) << 32 | static_cast<unsigned int>(waitingTicks)));
+}
 
 void Boulder::clearEarth() {
     for (int i = 0; i < SPRITE_WIDTH; ++i) {
@@ -271,25 +482,34 @@ void Boulder::doSomething() {
     switch (state) {
         case State::STABLE:
             if (!getWorld()->isEarthBelowBoulder(getX(), getY())) {
+                unsigned long long before = hashTermIfTracked();
                 state = State::WAITING;
                 waitingTicks = 30;
+                stateChanged(before);
             }
             break;
         case State::WAITING:
-            waitingTicks--;
-            if (waitingTicks <= 0) {
-                state = State::FALLING;
-                getWorld()->playSound(SOUND_FALLING_ROCK);
+            {
+                unsigned long long before = hashTermIfTracked();
+                waitingTicks--;
+                if (waitingTicks <= 0) {
+                    state = State::FALLING;
+                    getWorld()->playSound(SOUND_FALLING_ROCK);
+                }
+                stateChanged(before);
             }
             break;
         case State::FALLING:
             {
                 int targetY = getY() - 1;
-                if (targetY < 0 || getWorld()->isEarthUnderneath4x4(getX(), targetY) || getWorld()->isBoulderAtLocation(getX(), targetY, 0.0)) {
+                if (targetY < 0 || getWorld()->isEarthUnderneath4x4(getX(), targetY) || getWorld()->isBoulderAtLocation(getX(), targetY, 0)) {
                     setDead();
+                    getWorld()->boulderRemoved(getX(), getY());
                 } else {
+                    int fromY = getY();
                     moveTo(getX(), targetY);
-                    getWorld()->damageActorsInRadius(this, getX(), getY(), 3.0, 100);
+                    getWorld()->boulderMoved(getX(), fromY, getX(), targetY);
+                    getWorld()->damageActorsInRadius(this, getX(), getY(), 3, 100);
                 }
             }
             break;
@@ -312,17 +532,46 @@ Squirt::Squirt(StudentWorld* world_ptr, int startX, int startY, Direction dir)
     : Actor(TID_WATER_SPURT, startX, startY, dir, 1.0, 1, world_ptr, 0, true),
       remainingDistance(4) {}
 
-Squirt::~Squirt() {}
+Squirt::~Squirt() {
+    setHashTracked(false);
+}
+
+Actor::Kind Squirt::getKind() const { return KIND_SQUIRT; }
+
+Actor* Squirt::clone(StudentWorld* world_ptr) const { return new Squirt(*this, world_ptr); }
+
+void Squirt::saveState(ByteWriter& out) const {
+    Actor::saveState(out);
+    out.writeInt(remainingDistance);
+}
+
+Squirt::Squirt(const Squirt& other, StudentWorld* world_ptr)
+    : Actor(other, world_ptr), remainingDistance(other.remainingDistance) {
+}
+
+bool Squirt::loadState(ByteReader& in) {
+    if (!Actor::loadState(in)) return false;
+    unsigned long long before = hashTermIfTracked();
+    bool ok = in.readInt(remainingDistance);
+    stateChanged(before);
+    return ok;
+}
+
+unsigned long long Squirt::getStateHashTerm() const {
+    return finalizeHash(Actor::getStateHashTerm() ^ static_cast<unsigned int>(remainingDistance));
+}
 
 void Squirt::doSomething() {
     if (!isAlive()) return;
 
-    if (getWorld()->annoyProtestersInRadius(this, getX(), getY(), 3.0, 2)) {
+    if (getWorld()->annoyProtestersInRadius(this, getX(), getY(), 3, 2)) {
         setDead();
         return;
     }
 
+    unsigned long long before = hashTermIfTracked();
     remainingDistance--;
+    stateChanged(before);
     if (remainingDistance < 0) {
         setDead();
         return;
@@ -355,20 +604,32 @@ bool Squirt::annoy(int damagePoints) { return false; }
 Goodie::Goodie(int imageID, int startX, int startY, StudentWorld* world_ptr, int point_value, int initialHP, bool initiallyVisible)
     : Actor(imageID, startX, startY, right, 1.0, 2, world_ptr, initialHP, initiallyVisible), points(point_value) {}
 
+Goodie::Goodie(const Goodie& other, StudentWorld* world_ptr)
+    : Actor(other, world_ptr), points(other.points) {}
+
 Goodie::~Goodie() {}
 
+void Goodie::saveState(ByteWriter& out) const {
+    Actor::saveState(out);
+    out.writeInt(points);
+}
+
+bool Goodie::loadState(ByteReader& in) {
+    return Actor::loadState(in) && in.readInt(points);
+}
+
 void Goodie::doSomething() {
     if (!isAlive()) return;
 
     TunnelMan* tm = getWorld()->getTunnelMan();
     if (tm == nullptr || !tm->isAlive()) return;
 
-    if (!isVisible() && getWorld()->distance(getX(), getY(), tm->getX(), tm->getY()) <= 4.0) {
+    if (!isVisible() && isWithinRadius(getX(), getY(), tm->getX(), tm->getY(), 4)) {
         setVisibleWithCheck(true);
         return;
     }
 
-    if (isVisible() && canBePickedUpByTunnelMan() && getWorld()->distance(getX(), getY(), tm->getX(), tm->getY()) <= 3.0) {
+    if (isVisible() && canBePickedUpByTunnelMan() && isWithinRadius(getX(), getY(), tm->getX(), tm->getY(), 3)) {
         setDead();
         getWorld()->increaseScore(points);
         activate(tm);
@@ -388,8 +649,15 @@ int Goodie::getPoints() const { return points; }
 BarrelOfOil::BarrelOfOil(StudentWorld* world_ptr, int startX, int startY)
     : Goodie(TID_BARREL, startX, startY, world_ptr, 1000, 0, false) {}
 
+BarrelOfOil::BarrelOfOil(const BarrelOfOil& other, StudentWorld* world_ptr)
+    : Goodie(other, world_ptr) {}
+
 BarrelOfOil::~BarrelOfOil() {}
 
+Actor::Kind BarrelOfOil::getKind() const { return KIND_BARREL; }
+
+Actor* BarrelOfOil::clone(StudentWorld* world_ptr) const { return new BarrelOfOil(*this, world_ptr); }
+
 void BarrelOfOil::activate(TunnelMan* tunnelman) {
     getWorld()->playSound(SOUND_FOUND_OIL);
     getWorld()->decrementBarrelsRemaining();
@@ -407,7 +675,44 @@ Gold::Gold(StudentWorld* world_ptr, int startX, int startY, bool isTemporary)
     : Goodie(TID_GOLD, startX, startY, world_ptr, 0, 0, true),
       goldState(State::TEMPORARY_FOR_PROTESTER), totalTicks(100), pickedUpByProtester(false) {}
 
-Gold::~Gold() {}
+Gold::Gold(const Gold& other, StudentWorld* world_ptr)
+    : Goodie(other, world_ptr),
+      goldState(other.goldState), totalTicks(other.totalTicks), pickedUpByProtester(other.pickedUpByProtester) {}
+
+Gold::~Gold() {
+    setHashTracked(false);
+}
+
+Actor::Kind Gold::getKind() const { return KIND_GOLD; }
+
+Actor* Gold::clone(StudentWorld* world_ptr) const { return new Gold(*this, world_ptr); }
+
+void Gold::saveState(ByteWriter& out) const {
+    Goodie::saveState(out);
+    out.writeByte(static_cast<unsigned char>(goldState));
+    out.writeInt(totalTicks);
+    out.writeBool(pickedUpByProtester);
+}
+
+bool Gold::loadState(ByteReader& in) {
+    unsigned char stateValue;
+    if (!Goodie::loadState(in) || !in.readByte(stateValue) ||
+        stateValue > static_cast<unsigned char>(State::TEMPORARY_FOR_PROTESTER)) {
+        return false;
+    }
+    unsigned long long before = hashTermIfTracked();
+    goldState = static_cast<State>(stateValue);
+    bool ok = in.readInt(totalTicks) && in.readBool(pickedUpByProtester);
+    stateChanged(before);
+    return ok;
+}
+
+unsigned long long Gold::getStateHashTerm() const {
+    return finalizeHash(Actor::getStateHashTerm() ^
+                        (static_cast<unsigned long long>(goldState) << 40 |
+                         static_cast<unsigned long long>(pickedUpByProtester) << 32 |
+                         static_cast<unsigned int>(totalTicks)));
+}
 
 void Gold::doSomething() {
     if (!isAlive()) return;
@@ -415,7 +720,9 @@ void Gold::doSomething() {
     if (goldState == State::PERMANENT_FOR_TUNNELMAN) {
         Goodie::doSomething();
     } else {
+        unsigned long long before = hashTermIfTracked();
         totalTicks--;
+        stateChanged(before);
         if (totalTicks <= 0) {
             setDead();
             return;
@@ -432,7 +739,9 @@ bool Gold::canBePickedUpByProtester() const {
 }
 
 void Gold::setPickedUpByProtester(bool pickedUp){
+     unsigned long long before = hashTermIfTracked();
      pickedUpByProtester = pickedUp;
+     stateChanged(before);
 }
 bool Gold::wasPickedUpByProtester() const {
     return pickedUpByProtester;
@@ -452,12 +761,36 @@ void Gold::activate(TunnelMan* tunnelman) {
 TemporaryGoodie::TemporaryGoodie(int imageID, int startX, int startY, StudentWorld* world_ptr, int point_value, int lifetime)
     : Goodie(imageID, startX, startY, world_ptr, point_value, 0, true), totalTicksRemaining(lifetime) {}
 
-TemporaryGoodie::~TemporaryGoodie() {}
+TemporaryGoodie::TemporaryGoodie(const TemporaryGoodie& other, StudentWorld* world_ptr)
+    : Goodie(other, world_ptr), totalTicksRemaining(other.totalTicksRemaining) {}
+
+TemporaryGoodie::~TemporaryGoodie() {
+    setHashTracked(false);
+}
+
+void TemporaryGoodie::saveState(ByteWriter& out) const {
+    Goodie::saveState(out);
+    out.writeInt(totalTicksRemaining);
+}
+
+bool TemporaryGoodie::loadState(ByteReader& in) {
+    if (!Goodie::loadState(in)) return false;
+    unsigned long long before = hashTermIfTracked();
+    bool ok = in.readInt(totalTicksRemaining);
+    stateChanged(before);
+    return ok;
+}
+
+unsigned long long TemporaryGoodie::getStateHashTerm() const {
+    return finalizeHash(Actor::getStateHashTerm() ^ static_cast<unsigned int>(totalTicksRemaining));
+}
 
 void TemporaryGoodie::doSomething() {
     if (!isAlive()) return;
 
+    unsigned long long before = hashTermIfTracked();
     totalTicksRemaining--;
+    stateChanged(before);
     if (totalTicksRemaining <= 0) {
         setDead();
         return;
@@ -471,8 +804,15 @@ void TemporaryGoodie::doSomething() {
 SonarKit::SonarKit(StudentWorld* world_ptr, int startX, int startY, int lifetime)
     : TemporaryGoodie(TID_SONAR, startX, startY, world_ptr, 75, lifetime) {}
 
+SonarKit::SonarKit(const SonarKit& other, StudentWorld* world_ptr)
+    : TemporaryGoodie(other, world_ptr) {}
+
 SonarKit::~SonarKit() {}
 
+Actor::Kind SonarKit::getKind() const { return KIND_SONAR_KIT; }
+
+Actor* SonarKit::clone(StudentWorld* world_ptr) const { return new SonarKit(*this, world_ptr); }
+
 void SonarKit::activate(TunnelMan* tunnelman) {
     getWorld()->playSound(SOUND_GOT_GOODIE);
     tunnelman->addSonar(2);
@@ -484,8 +824,15 @@ void SonarKit::activate(TunnelMan* tunnelman) {
 WaterPool::WaterPool(StudentWorld* world_ptr, int startX, int startY, int lifetime)
     : TemporaryGoodie(TID_WATER_POOL, startX, startY, world_ptr, 100, lifetime) {}
 
+WaterPool::WaterPool(const WaterPool& other, StudentWorld* world_ptr)
+    : TemporaryGoodie(other, world_ptr) {}
+
 WaterPool::~WaterPool() {}
 
+Actor::Kind WaterPool::getKind() const { return KIND_WATER_POOL; }
+
+Actor* WaterPool::clone(StudentWorld* world_ptr) const { return new WaterPool(*this, world_ptr); }
+
 void WaterPool::activate(TunnelMan* tunnelman) {
     getWorld()->playSound(SOUND_GOT_GOODIE);
     tunnelman->addWater(5);
@@ -507,7 +854,79 @@ Protester::Protester(int imageID, StudentWorld* world_ptr, int initialHP)
     pickNewRandomDirectionAndSteps();
 }
 
-Protester::~Protester() {}
+Protester::Protester(const Protester& other, StudentWorld* world_ptr)
+    : Actor(other, world_ptr),
+      ticksToWaitBetweenMoves(other.ticksToWaitBetweenMoves),
+      restingTicks(other.restingTicks),
+      numSquaresToMoveInCurrentDirection(other.numSquaresToMoveInCurrentDirection),
+      mustLeave(other.mustLeave),
+      ticksSinceLastShout(other.ticksSinceLastShout),
+      ticksSinceLastPerpendicularTurn(other.ticksSinceLastPerpendicularTurn),
+      exitRequest(other.exitRequest),
+      approachRequest(other.approachRequest),
+      trackRequest(other.trackRequest)
+{
+    exitRequest.pendingTicket = 0;
+    approachRequest.pendingTicket = 0;
+    trackRequest.pendingTicket = 0;
+}
+
+Protester::~Protester() {
+    setHashTracked(false);
+    getWorld()->releasePathRequest(exitRequest);
+    getWorld()->releasePathRequest(approachRequest);
+    getWorld()->releasePathRequest(trackRequest);
+}
+
+// An outstanding async path job is not saved; the restored protester submits a new one.
+void Protester::saveState(ByteWriter& out) const {
+    Actor::saveState(out);
+    out.writeInt(ticksToWaitBetweenMoves);
+    out.writeInt(restingTicks);
+    out.writeInt(numSquaresToMoveInCurrentDirection);
+    out.writeBool(mustLeave);
+    out.writeInt(ticksSinceLastShout);
+    out.writeInt(ticksSinceLastPerpendicularTurn);
+    for (const PathRequest* request : {&exitRequest, &approachRequest, &trackRequest}) {
+        out.writeBool(request->deferred);
+        out.writeByte(static_cast<unsigned char>(request->lastDirection));
+    }
+}
+
+bool Protester::loadState(ByteReader& in) {
+    if (!Actor::loadState(in)) return false;
+    unsigned long long before = hashTermIfTracked();
+    bool ok = in.readInt(ticksToWaitBetweenMoves) && in.readInt(restingTicks) &&
+              in.readInt(numSquaresToMoveInCurrentDirection) && in.readBool(mustLeave) &&
+              in.readInt(ticksSinceLastShout) && in.readInt(ticksSinceLastPerpendicularTurn);
+    for (PathRequest* request : {&exitRequest, &approachRequest, &trackRequest}) {
+        unsigned char lastDirection;
+        if (!ok || !in.readBool(request->deferred) || !in.readByte(lastDirection) || lastDirection > right) {
+            ok = false;
+            break;
+        }
+        request->lastDirection = static_cast<Direction>(lastDirection);
+    }
+    stateChanged(before);
+    return ok;
+}
+
+// Each path request adds whether it was deferred and the direction it would fall back on.
+unsigned long long Protester::getStateHashTerm() const {
+    unsigned long long requests = 0;
+    for (const PathRequest* request : {&exitRequest, &approachRequest, &trackRequest}) {
+        requests = requests << 4 | static_cast<unsigned long long>(request->deferred) << 3 |
+                   static_cast<unsigned long long>(request->lastDirection);
+    }
+    unsigned long long term = finalizeHash(Actor::getStateHashTerm() ^
+        (static_cast<unsigned long long>(restingTicks & 0xFFFF) << 48 |
+         static_cast<unsigned long long>(numSquaresToMoveInCurrentDirection & 0xFFFF) << 32 |
+         static_cast<unsigned long long>(ticksSinceLastShout & 0xFFFF) << 16 |
+         static_cast<unsigned long long>(ticksSinceLastPerpendicularTurn & 0xFFFF)));
+    return finalizeHash(term ^
+        (static_cast<unsigned long long>(ticksToWaitBetweenMoves & 0xFFFF) << 32 |
+         static_cast<unsigned long long>(mustLeave) << 16 | requests));
+}
 
 void Protester::doSomething() {
     if (!isAlive()) return;
@@ -517,9 +936,7 @@ void Protester::doSomething() {
         return;
     }
 
-    setRestingTicks(ticksToWaitBetweenMoves);
-    ticksSinceLastShout++;
-    ticksSinceLastPerpendicularTurn++;
+    startActiveTick();
 
     if (mustLeave) {
         if (getX() == 60 && getY() == 60) {
@@ -527,7 +944,7 @@ void Protester::doSomething() {
             return;
         }
         Direction exitDir = getNextMoveToExit();
-        if (exitDir != none) {
+        if (exitDir != none && canMoveInDirection(exitDir)) {
              setDirection(exitDir);
              moveTo(getX() + (exitDir == right ? 1 : (exitDir == left ? -1 : 0)),
                     getY() + (exitDir == up ? 1 : (exitDir == down ? -1 : 0)));
@@ -555,9 +972,9 @@ void Protester::doSomething() {
 
     if (getWorld()->canProtesterMoveTo(this, nextX, nextY)) {
         moveTo(nextX, nextY);
-        numSquaresToMoveInCurrentDirection--;
+        setSquaresToMove(numSquaresToMoveInCurrentDirection - 1);
     } else {
-        numSquaresToMoveInCurrentDirection = 0;
+        setSquaresToMove(0);
     }
 }
 
@@ -585,8 +1002,10 @@ bool Protester::isDamageable() const { return !mustLeave; }
 
 
 void Protester::setMustLeaveOilField() {
+    unsigned long long before = hashTermIfTracked();
     mustLeave = true;
     restingTicks = 0;
+    stateChanged(before);
 }
 
 bool Protester::mustLeaveOilField() const {
@@ -598,16 +1017,34 @@ bool Protester::isResting() const {
 }
 
 void Protester::decrementRestingTicks() {
+    unsigned long long before = hashTermIfTracked();
     if (restingTicks > 0) restingTicks--;
+    stateChanged(before);
 }
 
 void Protester::setRestingTicks(int ticks_val) {
+    unsigned long long before = hashTermIfTracked();
     restingTicks = ticks_val;
+    stateChanged(before);
+}
+
+void Protester::startActiveTick() {
+    unsigned long long before = hashTermIfTracked();
+    restingTicks = ticksToWaitBetweenMoves;
+    ticksSinceLastShout++;
+    ticksSinceLastPerpendicularTurn++;
+    stateChanged(before);
+}
+
+void Protester::setSquaresToMove(int squares) {
+    unsigned long long before = hashTermIfTracked();
+    numSquaresToMoveInCurrentDirection = squares;
+    stateChanged(before);
 }
 
 bool Protester::attemptToShout() {
     TunnelMan* tm = getWorld()->getTunnelMan();
-    if (tm && tm->isAlive() && getWorld()->distance(getX(), getY(), tm->getX(), tm->getY()) <= 4.0) {
+    if (tm && tm->isAlive() && isWithinRadius(getX(), getY(), tm->getX(), tm->getY(), 4)) {
         bool facingPlayer = false;
         if (getDirection() == right && tm->getX() >= getX() && abs(tm->getY() - getY()) < SPRITE_HEIGHT) facingPlayer = true;
         else if (getDirection() == left && tm->getX() <= getX() && abs(tm->getY() - getY()) < SPRITE_HEIGHT) facingPlayer = true;
@@ -617,7 +1054,9 @@ bool Protester::attemptToShout() {
         if (facingPlayer && ticksSinceLastShout > 15) {
             getWorld()->playSound(SOUND_PROTESTER_YELL);
             tm->annoy(2);
+            unsigned long long before = hashTermIfTracked();
             ticksSinceLastShout = 0;
+            stateChanged(before);
             return true;
         }
     }
@@ -629,7 +1068,9 @@ bool Protester::lineOfSightToTunnelman(int& dx, int& dy, int& distance) {
 }
 
 bool Protester::moveTowards(int targetX, int targetY){
-    Direction dir = getWorld()->getPathToCoordinate(getX(), getY(), targetX, targetY);
+    unsigned long long before = hashTermIfTracked();
+    Direction dir = getWorld()->getPathToCoordinate(getX(), getY(), targetX, targetY, &approachRequest);
+    stateChanged(before);
     if (dir != none && canMoveInDirection(dir)) {
         setDirection(dir);
         moveTo(getX() + (dir == right ? 1 : (dir == left ? -1 : 0)),
@@ -647,12 +1088,12 @@ void Protester::pickNewRandomDirectionAndSteps() {
     if (canMoveInDirection(right)) possibleDirs.push_back(right);
 
     if (!possibleDirs.empty()) {
-        setDirection(possibleDirs[rand() % possibleDirs.size()]);
+        setDirection(possibleDirs[getWorld()->getRandom().nextInt(static_cast<int>(possibleDirs.size()))]);
     } else {
         Direction dirs[] = {up, down, left, right};
-        setDirection(dirs[rand() % 4]);
+        setDirection(dirs[getWorld()->getRandom().nextInt(4)]);
     }
-    numSquaresToMoveInCurrentDirection = (rand() % 53) + 8;
+    setSquaresToMove(getWorld()->getRandom().nextInt(53) + 8);
 }
 
 bool Protester::canMoveInDirection(Direction dir) const {
@@ -667,11 +1108,20 @@ bool Protester::canMoveInDirection(Direction dir) const {
     return getWorld()->canProtesterMoveTo(this, nextX, nextY);
 }
 
+// The world updates the request in place, which changes this protester's hash term.
 GraphObject::Direction Protester::getNextMoveToExit() {
-    return getWorld()->getPathToExit(getX(), getY());
+    unsigned long long before = hashTermIfTracked();
+    Direction dir = getWorld()->getPathToExit(getX(), getY(), &exitRequest);
+    stateChanged(before);
+    return dir;
 }
-GraphObject::Direction Protester::getNextMoveToTunnelMan(int targetX, int targetY){
-    return getWorld()->getPathToCoordinate(getX(),getY(), targetX, targetY);
+GraphObject::Direction Protester::getNextMoveToTunnelMan(int targetX, int targetY, int maxSteps){
+    Direction firstStep;
+    unsigned long long before = hashTermIfTracked();
+    bool withinRange = getWorld()->isWithinPathDistance(getX(), getY(), targetX, targetY, maxSteps, firstStep, &trackRequest);
+    stateChanged(before);
+    if (!withinRange) return none;
+    return firstStep;
 }
 
 
@@ -681,17 +1131,22 @@ GraphObject::Direction Protester::getNextMoveToTunnelMan(int targetX, int target
 RegularProtester::RegularProtester(StudentWorld* world_ptr, int initialHP)
     : Protester(TID_PROTESTER, world_ptr, initialHP == 0 ? 5 : initialHP) {}
 
+RegularProtester::RegularProtester(const RegularProtester& other, StudentWorld* world_ptr)
+    : Protester(other, world_ptr) {}
+
 RegularProtester::~RegularProtester() {}
 
+Actor::Kind RegularProtester::getKind() const { return KIND_REGULAR_PROTESTER; }
+
+Actor* RegularProtester::clone(StudentWorld* world_ptr) const { return new RegularProtester(*this, world_ptr); }
+
 void RegularProtester::doSomething() {
     if (!isAlive()) return;
     if (isResting()) {
         decrementRestingTicks();
         return;
     }
-    setRestingTicks(ticksToWaitBetweenMoves);
-    ticksSinceLastShout++;
-    ticksSinceLastPerpendicularTurn++;
+    startActiveTick();
 
     if (mustLeaveOilField()) {
         Protester::doSomething();
@@ -716,14 +1171,14 @@ void RegularProtester::doSomething() {
                     setDirection(targetDir);
                     moveTo(getX() + (targetDir == right ? 1 : (targetDir == left ? -1 : 0)),
                            getY() + (targetDir == up ? 1 : (targetDir == down ? -1 : 0)));
-                    numSquaresToMoveInCurrentDirection = 0;
+                    setSquaresToMove(0);
                     return;
                 }
             }
         }
     }
 
-    numSquaresToMoveInCurrentDirection--;
+    setSquaresToMove(numSquaresToMoveInCurrentDirection - 1);
     if (numSquaresToMoveInCurrentDirection <= 0) {
         pickNewRandomDirectionAndSteps();
     } else {
@@ -739,9 +1194,11 @@ void RegularProtester::doSomething() {
             }
 
             if (!perpendicularOptions.empty()) {
-                setDirection(perpendicularOptions[rand() % perpendicularOptions.size()]);
-                numSquaresToMoveInCurrentDirection = (rand() % 53) + 8;
+                setDirection(perpendicularOptions[getWorld()->getRandom().nextInt(static_cast<int>(perpendicularOptions.size()))]);
+                unsigned long long before = hashTermIfTracked();
+                numSquaresToMoveInCurrentDirection = getWorld()->getRandom().nextInt(53) + 8;
                 ticksSinceLastPerpendicularTurn = 0;
+                stateChanged(before);
             }
         }
     }
@@ -750,7 +1207,7 @@ void RegularProtester::doSomething() {
          moveTo(getX() + (getDirection() == right ? 1 : (getDirection() == left ? -1 : 0)),
                 getY() + (getDirection() == up ? 1 : (getDirection() == down ? -1 : 0)));
     } else {
-        numSquaresToMoveInCurrentDirection = 0;
+        setSquaresToMove(0);
     }
 }
 
@@ -782,13 +1239,41 @@ bool RegularProtester::annoy(int damagePoints) {
 HardcoreProtester::HardcoreProtester(StudentWorld* world_ptr, int initialHP)
     : Protester(TID_HARD_CORE_PROTESTER, world_ptr, initialHP == 0 ? 20 : initialHP), ticksToStareAtGold(0) {}
 
-HardcoreProtester::~HardcoreProtester() {}
+HardcoreProtester::HardcoreProtester(const HardcoreProtester& other, StudentWorld* world_ptr)
+    : Protester(other, world_ptr), ticksToStareAtGold(other.ticksToStareAtGold) {}
+
+HardcoreProtester::~HardcoreProtester() {
+    setHashTracked(false);
+}
+
+Actor::Kind HardcoreProtester::getKind() const { return KIND_HARDCORE_PROTESTER; }
+
+Actor* HardcoreProtester::clone(StudentWorld* world_ptr) const { return new HardcoreProtester(*this, world_ptr); }
+
+void HardcoreProtester::saveState(ByteWriter& out) const {
+    Protester::saveState(out);
+    out.writeInt(ticksToStareAtGold);
+}
+
+bool HardcoreProtester::loadState(ByteReader& in) {
+    if (!Protester::loadState(in)) return false;
+    unsigned long long before = hashTermIfTracked();
+    bool ok = in.readInt(ticksToStareAtGold);
+    stateChanged(before);
+    return ok;
+}
+
+unsigned long long HardcoreProtester::getStateHashTerm() const {
+    return finalizeHash(Protester::getStateHashTerm() ^ static_cast<unsigned int>(ticksToStareAtGold));
+}
 
 void HardcoreProtester::doSomething() {
     if (!isAlive()) return;
 
     if (ticksToStareAtGold > 0) {
+        unsigned long long before = hashTermIfTracked();
         ticksToStareAtGold--;
+        stateChanged(before);
         setRestingTicks(1);
         return;
     }
@@ -797,9 +1282,7 @@ void HardcoreProtester::doSomething() {
         decrementRestingTicks();
         return;
     }
-    setRestingTicks(ticksToWaitBetweenMoves);
-    ticksSinceLastShout++;
-    ticksSinceLastPerpendicularTurn++;
+    startActiveTick();
 
 
     if (mustLeaveOilField()) {
@@ -812,14 +1295,12 @@ void HardcoreProtester::doSomething() {
     TunnelMan* tm = getWorld()->getTunnelMan();
     if (tm && tm->isAlive()) {
         int M = 16 + getWorld()->getLevel() * 2;
-        if (getWorld()->getPathDistanceToCoordinate(getX(), getY(), tm->getX(), tm->getY()) <= M) {
-            Direction dirToTM = getNextMoveToTunnelMan(tm->getX(), tm->getY());
-            if (dirToTM != none && canMoveInDirection(dirToTM)) {
-                setDirection(dirToTM);
-                moveTo(getX() + (dirToTM == right ? 1 : (dirToTM == left ? -1 : 0)),
-                       getY() + (dirToTM == up ? 1 : (dirToTM == down ? -1 : 0)));
-                return;
-            }
+        Direction dirToTM = getNextMoveToTunnelMan(tm->getX(), tm->getY(), M);
+        if (dirToTM != none && canMoveInDirection(dirToTM)) {
+            setDirection(dirToTM);
+            moveTo(getX() + (dirToTM == right ? 1 : (dirToTM == left ? -1 : 0)),
+                   getY() + (dirToTM == up ? 1 : (dirToTM == down ? -1 : 0)));
+            return;
         }
     }
 
@@ -835,14 +1316,14 @@ void HardcoreProtester::doSomething() {
                     setDirection(targetDir);
                     moveTo(getX() + (targetDir == right ? 1 : (targetDir == left ? -1 : 0)),
                            getY() + (targetDir == up ? 1 : (targetDir == down ? -1 : 0)));
-                    numSquaresToMoveInCurrentDirection = 0;
+                    setSquaresToMove(0);
                     return;
                 }
             }
         }
     }
 
-    numSquaresToMoveInCurrentDirection--;
+    setSquaresToMove(numSquaresToMoveInCurrentDirection - 1);
     if (numSquaresToMoveInCurrentDirection <= 0) {
         pickNewRandomDirectionAndSteps();
     } else {
@@ -857,9 +1338,11 @@ void HardcoreProtester::doSomething() {
                 if (canMoveInDirection(right)) perpendicularOptions.push_back(right);
             }
             if (!perpendicularOptions.empty()) {
-                setDirection(perpendicularOptions[rand() % perpendicularOptions.size()]);
-                numSquaresToMoveInCurrentDirection = (rand() % 53) + 8;
+                setDirection(perpendicularOptions[getWorld()->getRandom().nextInt(static_cast<int>(perpendicularOptions.size()))]);
+                unsigned long long before = hashTermIfTracked();
+                numSquaresToMoveInCurrentDirection = getWorld()->getRandom().nextInt(53) + 8;
                 ticksSinceLastPerpendicularTurn = 0;
+                stateChanged(before);
             }
         }
     }
@@ -868,7 +1351,7 @@ void HardcoreProtester::doSomething() {
          moveTo(getX() + (getDirection() == right ? 1 : (getDirection() == left ? -1 : 0)),
                 getY() + (getDirection() == up ? 1 : (getDirection() == down ? -1 : 0)));
     } else {
-        numSquaresToMoveInCurrentDirection = 0;
+        setSquaresToMove(0);
     }
 }
 
@@ -876,7 +1359,9 @@ void HardcoreProtester::acceptGold() {
     getWorld()->playSound(SOUND_PROTESTER_FOUND_GOLD);
     getWorld()->increaseScore(50);
     int current_level_number = getWorld()->getLevel();
+    unsigned long long before = hashTermIfTracked();
     ticksToStareAtGold = max(50, 100 - current_level_number * 10);
+    stateChanged(before);
     setRestingTicks(ticksToStareAtGold);
 }
 
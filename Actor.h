@@ -3,16 +3,26 @@
 
 #include "GraphObject.h"
 #include "GameConstants.h"
+#include "PathScheduler.h"
+#include "ActorPool.h"
+#include <cstddef>
 
 class StudentWorld;
+class ByteWriter;
+class ByteReader;
 
 
 class Actor : public GraphObject {
 public:
     Actor(int imageID, int startX, int startY, Direction dir, double size, unsigned int depth, StudentWorld* world, int initialHP = 0, bool initiallyVisible = true);
+    // Copies another actor's state into a new one that belongs to the given world.
+    Actor(const Actor& other, StudentWorld* world);
     virtual ~Actor();
     virtual void doSomething() = 0;
 
+    static void* operator new(std::size_t size) { return ActorPool::allocate(size); }
+    static void operator delete(void* block, std::size_t size) { ActorPool::release(block, size); }
+
     virtual bool annoy(int damagePoints);
 
     bool isAlive() const;
@@ -29,15 +39,52 @@ public:
     virtual bool isDamageable() const;
     void setVisibleWithCheck(bool visible);
 
+    // These hide GraphObject's versions so that a change to an actor in the world's list also
+    // updates the world's running state hash.
+    void moveTo(int x, int y);
+    void teleportTo(int x, int y);
+    void setDirection(Direction dir);
+
+    // This actor's share of the world state hash: position, direction, visibility, life and hit
+    // points, plus whatever else a subclass keeps that decides what it does next. While tracked,
+    // every change swaps the old share for the new one in the world's sum. A subclass that adds
+    // to the term untracks itself in its own destructor, while the term still includes its part.
+    virtual unsigned long long getStateHashTerm() const;
+    void setHashTracked(bool tracked);
+    bool isHashTracked() const { return hashTracked; }
+
+    // Snapshot support. The world writes each actor's kind and position; saveState() appends the
+    // rest, each subclass after its base, and loadState() reads the fields back in the same order.
+    enum Kind { KIND_TUNNELMAN, KIND_EARTH, KIND_BOULDER, KIND_SQUIRT, KIND_BARREL, KIND_GOLD,
+                KIND_SONAR_KIT, KIND_WATER_POOL, KIND_REGULAR_PROTESTER, KIND_HARDCORE_PROTESTER };
+    virtual Kind getKind() const = 0;
+    virtual void saveState(ByteWriter& out) const;
+    virtual bool loadState(ByteReader& in);
+    // A fresh actor of the given kind at (x, y) for loadState() to fill in, or nullptr if the
+    // kind is not one the world keeps in its actor list.
+    static Actor* createForRestore(int kind, StudentWorld* world, int x, int y);
+    // A copy of this actor, in the same state, for a cloned world.
+    virtual Actor* clone(StudentWorld* world) const = 0;
+
+protected:
+    void revive(int hp);
+    // Bracket any change to what getStateHashTerm() reads: take the term first, report after. A
+    // missed bracket leaves the world's running sum stale without any other symptom; debug builds
+    // catch it when replays record or verify checksums (StudentWorld::actorHashIsConsistent()).
+    unsigned long long hashTermIfTracked() const;
+    void stateChanged(unsigned long long termBefore);
+
 private:
     StudentWorld* world;
     bool alive;
     int hp;
+    bool hashTracked;
 };
 
 class TunnelMan : public Actor {
 public:
     TunnelMan(StudentWorld* world);
+    TunnelMan(const TunnelMan& other, StudentWorld* world);
     virtual ~TunnelMan();
 
     virtual void doSomething() override;
@@ -45,6 +92,14 @@ public:
     virtual bool blocksMovement() const override;
     virtual bool canBeBonked() const override;
     virtual bool isDamageable() const override;
+    virtual Kind getKind() const override;
+    virtual Actor* clone(StudentWorld* world) const override;
+    virtual void saveState(ByteWriter& out) const override;
+    virtual bool loadState(ByteReader& in) override;
+    virtual unsigned long long getStateHashTerm() const override;
+
+    // Puts TunnelMan back at the start of a level with a fresh inventory.
+    void reset();
 
     void addGold(int amount = 1);
     void useGold();
@@ -67,11 +122,14 @@ private:
 class Earth : public Actor {
 public:
     Earth(StudentWorld* world, int startX, int startY);
+    Earth(const Earth& other, StudentWorld* world);
     virtual ~Earth();
 
     virtual void doSomething() override;
     virtual bool blocksMovement() const override;
     virtual bool annoy(int damagePoints) override;
+    virtual Kind getKind() const override;
+    virtual Actor* clone(StudentWorld* world) const override;
 };
 
 class Boulder : public Actor {
@@ -79,11 +137,17 @@ public:
     enum class State { STABLE, WAITING, FALLING };
 
     Boulder(StudentWorld* world, int startX, int startY);
+    Boulder(const Boulder& other, StudentWorld* world);
     virtual ~Boulder();
 
     virtual void doSomething() override;
     virtual bool blocksMovement() const override;
     virtual bool annoy(int damagePoints) override;
+    virtual Kind getKind() const override;
+    virtual Actor* clone(StudentWorld* world) const override;
+    virtual void saveState(ByteWriter& out) const override;
+    virtual bool loadState(ByteReader& in) override;
+    virtual unsigned long long getStateHashTerm() const override;
 
 private:
     State state;
@@ -94,11 +158,17 @@ private:
 class Squirt : public Actor {
 public:
     Squirt(StudentWorld* world, int startX, int startY, Direction dir);
+    Squirt(const Squirt& other, StudentWorld* world);
     virtual ~Squirt();
 
     virtual void doSomething() override;
     virtual bool blocksMovement() const override;
     virtual bool annoy(int damagePoints) override;
+    virtual Kind getKind() const override;
+    virtual Actor* clone(StudentWorld* world) const override;
+    virtual void saveState(ByteWriter& out) const override;
+    virtual bool loadState(ByteReader& in) override;
+    virtual unsigned long long getStateHashTerm() const override;
 
 private:
     int remainingDistance;
@@ -107,6 +177,7 @@ private:
 class Goodie : public Actor {
 public:
     Goodie(int imageID, int startX, int startY, StudentWorld* world, int points, int initialHP = 0, bool initiallyVisible = false);
+    Goodie(const Goodie& other, StudentWorld* world);
     virtual ~Goodie();
 
     virtual void doSomething() override;
@@ -114,6 +185,8 @@ public:
     virtual bool canBePickedUpByTunnelMan() const;
     int getPoints() const;
     virtual void activate(TunnelMan* tunnelman) = 0;
+    virtual void saveState(ByteWriter& out) const override;
+    virtual bool loadState(ByteReader& in) override;
 
 private:
     int points;
@@ -122,8 +195,11 @@ private:
 class BarrelOfOil : public Goodie {
 public:
     BarrelOfOil(StudentWorld* world, int startX, int startY);
+    BarrelOfOil(const BarrelOfOil& other, StudentWorld* world);
     virtual ~BarrelOfOil();
     virtual void activate(TunnelMan* tunnelman) override;
+    virtual Kind getKind() const override;
+    virtual Actor* clone(StudentWorld* world) const override;
 };
 
 class Gold : public Goodie {
@@ -132,6 +208,7 @@ public:
 
     Gold(StudentWorld* world, int startX, int startY);
     Gold(StudentWorld* world, int startX, int startY, bool isTemporary);
+    Gold(const Gold& other, StudentWorld* world);
     virtual ~Gold();
 
     virtual void doSomething() override;
@@ -142,6 +219,11 @@ public:
     virtual void activate(TunnelMan* tunnelman) override;
 
     State getGoldState() const { return goldState; }
+    virtual Kind getKind() const override;
+    virtual Actor* clone(StudentWorld* world) const override;
+    virtual void saveState(ByteWriter& out) const override;
+    virtual bool loadState(ByteReader& in) override;
+    virtual unsigned long long getStateHashTerm() const override;
 
 private:
     State goldState;
@@ -152,8 +234,12 @@ private:
 class TemporaryGoodie : public Goodie {
 public:
     TemporaryGoodie(int imageID, int startX, int startY, StudentWorld* world, int points, int lifetime);
+    TemporaryGoodie(const TemporaryGoodie& other, StudentWorld* world);
     virtual ~TemporaryGoodie();
     virtual void doSomething() override;
+    virtual void saveState(ByteWriter& out) const override;
+    virtual bool loadState(ByteReader& in) override;
+    virtual unsigned long long getStateHashTerm() const override;
 
 private:
     int totalTicksRemaining;
@@ -162,7 +248,10 @@ private:
 class SonarKit : public TemporaryGoodie {
 public:
     SonarKit(StudentWorld* world, int startX, int startY, int lifetime);
+    SonarKit(const SonarKit& other, StudentWorld* world);
     virtual ~SonarKit();
+    virtual Kind getKind() const override;
+    virtual Actor* clone(StudentWorld* world) const override;
 
 protected:
     virtual void activate(TunnelMan* tunnelman) override;
@@ -171,7 +260,10 @@ protected:
 class WaterPool : public TemporaryGoodie {
 public:
     WaterPool(StudentWorld* world, int startX, int startY, int lifetime);
+    WaterPool(const WaterPool& other, StudentWorld* world);
     virtual ~WaterPool();
+    virtual Kind getKind() const override;
+    virtual Actor* clone(StudentWorld* world) const override;
 
 protected:
     virtual void activate(TunnelMan* tunnelman) override;
@@ -180,6 +272,8 @@ protected:
 class Protester : public Actor {
 public:
     Protester(int imageID, StudentWorld* world, int initialHP);
+    // An async path job in flight stays with the original.
+    Protester(const Protester& other, StudentWorld* world);
     virtual ~Protester();
 
     virtual void doSomething() override;
@@ -194,11 +288,17 @@ public:
     bool mustLeaveOilField() const;
 
     virtual void acceptGold() = 0;
+    virtual void saveState(ByteWriter& out) const override;
+    virtual bool loadState(ByteReader& in) override;
+    virtual unsigned long long getStateHashTerm() const override;
 
 protected:
     bool isResting() const;
     void decrementRestingTicks();
     void setRestingTicks(int ticks);
+    // Rests until the next move and ages the shout and turn timers; run on every tick that acts.
+    void startActiveTick();
+    void setSquaresToMove(int squares);
     bool attemptToShout();
     bool lineOfSightToTunnelman(int& dx, int& dy, int& distance);
     bool moveTowards(int targetX, int targetY);
@@ -206,7 +306,7 @@ protected:
     bool canMoveInDirection(Direction dir) const;
 
     Direction getNextMoveToExit();
-    Direction getNextMoveToTunnelMan(int targetX, int targetY);
+    Direction getNextMoveToTunnelMan(int targetX, int targetY, int maxSteps);
 
     int ticksToWaitBetweenMoves;
     int restingTicks;
@@ -214,12 +314,19 @@ protected:
     bool mustLeave;
     int ticksSinceLastShout;
     int ticksSinceLastPerpendicularTurn;
+    // One per kind of query, so a deferred answer never comes from a different question.
+    PathRequest exitRequest;
+    PathRequest approachRequest;
+    PathRequest trackRequest;
 };
 
 class RegularProtester : public Protester {
 public:
     RegularProtester(StudentWorld* world, int initialHP);
+    RegularProtester(const RegularProtester& other, StudentWorld* world);
     virtual ~RegularProtester();
+    virtual Kind getKind() const override;
+    virtual Actor* clone(StudentWorld* world) const override;
 
     virtual void doSomething() override;
     virtual void acceptGold() override;
@@ -229,7 +336,13 @@ public:
 class HardcoreProtester : public Protester {
 public:
     HardcoreProtester(StudentWorld* world, int initialHP);
+    HardcoreProtester(const HardcoreProtester& other, StudentWorld* world);
     virtual ~HardcoreProtester();
+    virtual Kind getKind() const override;
+    virtual Actor* clone(StudentWorld* world) const override;
+    virtual void saveState(ByteWriter& out) const override;
+    virtual bool loadState(ByteReader& in) override;
+    virtual unsigned long long getStateHashTerm() const override;
 
     virtual void doSomething() override;
     virtual void acceptGold() override;
@@ -0,0 +1,68 @@
+#include "ActorPool.h"
+#include <new>
+using namespace std;
+
+namespace {
+    const size_t SIZE_CLASSES = ActorPool::MAX_POOLED_SIZE / ActorPool::GRANULE;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct FreeLists {
+        FreeBlock* heads[SIZE_CLASSES];
+
+        FreeLists() {
+            for (size_t i = 0; i < SIZE_CLASSES; ++i) {
+                heads[i] = nullptr;
+            }
+        }
+
+        ~FreeLists() {
+            for (size_t i = 0; i < SIZE_CLASSES; ++i) {
+                while (heads[i] != nullptr) {
+                    FreeBlock* block = heads[i];
+                    heads[i] = block->next;
+                    ::operator delete(block);
+                }
+            }
+        }
+    };
+
+    FreeLists& freeLists() {
+        thread_local FreeLists lists;
+        return lists;
+    }
+
+    size_t sizeClassOf(size_t size) {
+        return (size + ActorPool::GRANULE - 1) / ActorPool::GRANULE - 1;
+    }
+}
+
+void* ActorPool::allocate(size_t size) {
+    if (size == 0 || size > MAX_POOLED_SIZE) {
+        return ::operator new(size);
+    }
+    size_t sizeClass = sizeClassOf(size);
+    FreeLists& lists = freeLists();
+    if (FreeBlock* block = lists.heads[sizeClass]) {
+        lists.heads[sizeClass] = block->next;
+        return block;
+    }
+    return ::operator new((sizeClass + 1) * GRANULE);
+}
+
+void ActorPool::release(void* block, size_t size) {
+    if (block == nullptr) {
+        return;
+    }
+    if (size == 0 || size > MAX_POOLED_SIZE) {
+        ::operator delete(block);
+        return;
+    }
+    size_t sizeClass = sizeClassOf(size);
+    FreeLists& lists = freeLists();
+    FreeBlock* freed = static_cast<FreeBlock*>(block);
+    freed->next = lists.heads[sizeClass];
+    lists.heads[sizeClass] = freed;
+}
@@ -0,0 +1,20 @@
+#ifndef ACTORPOOL_H_
+#define ACTORPOOL_H_
+
+#include <cstddef>
+
+// Recycles actor allocations. Every level creates and destroys the same few actor types over and
+// over, so freed blocks go onto free lists bucketed by size and are handed back out on the next
+// allocation of that size instead of round-tripping through the heap. Lists are per thread, so
+// worlds stepped on different threads never contend; a block freed on another thread simply
+// joins that thread's lists.
+class ActorPool {
+public:
+    static void* allocate(std::size_t size);
+    static void release(void* block, std::size_t size);
+
+    static const std::size_t GRANULE = 16;
+    static const std::size_t MAX_POOLED_SIZE = 512;
+};
+
+#endif // ACTORPOOL_H_
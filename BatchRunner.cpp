@@ -0,0 +1,103 @@
+#include "BatchRunner.h"
+#include "StudentWorld.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+using namespace std;
+
+BatchRunner::BatchRunner(const BatchOptions& options)
+    : m_options(options) {
+}
+
+BatchResult BatchRunner::run() {
+    int games = max(0, m_options.games);
+    int threads = m_options.threads > 0 ? m_options.threads : static_cast<int>(thread::hardware_concurrency());
+    threads = max(1, min(threads, max(1, games)));
+
+    m_queues.clear();
+    for (int i = 0; i < threads; ++i) {
+        m_queues.push_back(unique_ptr<WorkQueue>(new WorkQueue));
+    }
+    for (int game = 0; game < games; ++game) {
+        m_queues[game % threads]->games.push_back(game);
+    }
+
+    BatchResult result = BatchResult();
+    result.games.resize(games);
+    auto start = chrono::steady_clock::now();
+
+    vector<thread> workers;
+    for (int i = 1; i < threads; ++i) {
+        workers.push_back(thread(&BatchRunner::work, this, i, ref(result.games)));
+    }
+    work(0, result.games);
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    result.total.wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    for (const GameResult& game : result.games) {
+        const DriverStats& stats = game.stats;
+        result.total.ticks += stats.ticks;
+        result.total.levelsStarted += stats.levelsStarted;
+        result.total.levelsCompleted += stats.levelsCompleted;
+        result.total.livesLost += stats.livesLost;
+        result.total.totalLevelGenerationMicros += stats.totalLevelGenerationMicros;
+        result.total.totalResetMicros += stats.totalResetMicros;
+        result.total.resets += stats.resets;
+        result.cpuSeconds += stats.wallSeconds;
+        result.meanScore += stats.finalScore;
+        result.meanLevel += stats.finalLevel;
+        result.maxScore = max(result.maxScore, stats.finalScore);
+        result.maxLevel = max(result.maxLevel, stats.finalLevel);
+    }
+    if (games > 0) {
+        result.meanScore /= games;
+        result.meanLevel /= games;
+    }
+    return result;
+}
+
+void BatchRunner::work(int worker, vector<GameResult>& results) {
+    int game;
+    while (takeGame(worker, game)) {
+        results[game] = playGame(game);
+    }
+}
+
+bool BatchRunner::takeGame(int worker, int& game) {
+    {
+        WorkQueue& own = *m_queues[worker];
+        lock_guard<mutex> guard(own.lock);
+        if (!own.games.empty()) {
+            game = own.games.front();
+            own.games.pop_front();
+            return true;
+        }
+    }
+    int count = static_cast<int>(m_queues.size());
+    for (int offset = 1; offset < count; ++offset) {
+        WorkQueue& victim = *m_queues[(worker + offset) % count];
+        lock_guard<mutex> guard(victim.lock);
+        if (!victim.games.empty()) {
+            game = victim.games.back();
+            victim.games.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+GameResult BatchRunner::playGame(int game) const {
+    GameResult result;
+    result.seed = m_options.seed + game;
+
+    StudentWorld world("");
+    world.setRandomSeed(result.seed);
+    unique_ptr<KeyScript> script = m_options.makeScript
+        ? m_options.makeScript(game, result.seed)
+        : unique_ptr<KeyScript>(new RandomKeyScript(result.seed));
+    HeadlessDriver driver(&world, script.get());
+    result.stats = driver.run(m_options.maxTicksPerGame);
+    return result;
+}
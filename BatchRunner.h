@@ -0,0 +1,62 @@
+#ifndef BATCHRUNNER_H_
+#define BATCHRUNNER_H_
+
+#include "HeadlessDriver.h"
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct BatchOptions {
+    BatchOptions() : games(1), threads(0), seed(0), maxTicksPerGame(0) {}
+
+    int games;
+    int threads;                        // 0 uses one per hardware thread
+    unsigned long long seed;            // game i is seeded with seed + i
+    unsigned long maxTicksPerGame;      // 0 plays every game to the end
+
+    // Builds the key policy for one game; a RandomKeyScript seeded like the world when unset.
+    std::function<std::unique_ptr<KeyScript>(int game, unsigned long long seed)> makeScript;
+};
+
+struct GameResult {
+    unsigned long long seed;
+    DriverStats stats;
+};
+
+struct BatchResult {
+    std::vector<GameResult> games;      // in game order, whatever thread ran them
+    DriverStats total;                  // sums over every game; wallSeconds is the batch's wall time
+    double cpuSeconds;                  // sum of the per-game wall times
+    double meanScore;
+    unsigned int maxScore;
+    double meanLevel;
+    unsigned int maxLevel;
+};
+
+// Plays many independent games, one StudentWorld per task, on a work-stealing pool. Games are
+// dealt round-robin into per-thread queues; a thread works from the front of its own queue and,
+// once that is empty, steals from the back of the others', so a few long games do not leave the
+// rest of the pool idle. Results depend only on the options, never on the thread count.
+class BatchRunner {
+public:
+    explicit BatchRunner(const BatchOptions& options);
+
+    BatchResult run();
+
+private:
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<int> games;
+    };
+
+    BatchOptions m_options;
+    std::vector<std::unique_ptr<WorkQueue> > m_queues;
+
+    void work(int worker, std::vector<GameResult>& results);
+    bool takeGame(int worker, int& game);
+    GameResult playGame(int game) const;
+};
+
+#endif // BATCHRUNNER_H_
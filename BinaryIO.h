@@ -0,0 +1,129 @@
+#ifndef BINARYIO_H_
+#define BINARYIO_H_
+
+#include <string>
+
+// Little helpers for the replay and snapshot formats. Integers are written either as LEB128
+// varints (small values in one byte) or as fixed-width little-endian words, so files read the
+// same on every platform.
+class ByteWriter {
+public:
+    void writeVarint(unsigned long long value) {
+        while (value >= 0x80) {
+            m_bytes.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        m_bytes.push_back(static_cast<char>(value));
+    }
+
+    // Zigzag-encodes so small negative numbers stay short.
+    void writeSignedVarint(long long value) {
+        writeVarint((static_cast<unsigned long long>(value) << 1) ^ static_cast<unsigned long long>(value >> 63));
+    }
+
+    void writeInt(int value) {
+        writeSignedVarint(value);
+    }
+
+    void writeBool(bool value) {
+        writeByte(value ? 1 : 0);
+    }
+
+    void writeByte(unsigned char value) {
+        m_bytes.push_back(static_cast<char>(value));
+    }
+
+    void writeFixed64(unsigned long long value) {
+        for (int i = 0; i < 8; ++i) {
+            m_bytes.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    void writeBytes(const std::string& bytes) {
+        m_bytes += bytes;
+    }
+
+    const std::string& bytes() const { return m_bytes; }
+
+private:
+    std::string m_bytes;
+};
+
+// Reads what ByteWriter wrote. Every read returns false, and the reader stays failed, once the
+// input runs out or a varint is malformed.
+class ByteReader {
+public:
+    explicit ByteReader(const std::string& bytes) : m_bytes(bytes), m_pos(0), m_failed(false) {}
+
+    bool readVarint(unsigned long long& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            unsigned char byte;
+            if (!readByte(byte)) return false;
+            value |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) return true;
+        }
+        m_failed = true;
+        return false;
+    }
+
+    bool readSignedVarint(long long& value) {
+        unsigned long long raw;
+        if (!readVarint(raw)) return false;
+        value = static_cast<long long>(raw >> 1) ^ -static_cast<long long>(raw & 1);
+        return true;
+    }
+
+    bool readInt(int& value) {
+        long long wide;
+        if (!readSignedVarint(wide)) return false;
+        value = static_cast<int>(wide);
+        return true;
+    }
+
+    bool readBool(bool& value) {
+        unsigned char byte;
+        if (!readByte(byte)) return false;
+        value = byte != 0;
+        return true;
+    }
+
+    bool readByte(unsigned char& value) {
+        if (m_failed || m_pos >= m_bytes.size()) {
+            m_failed = true;
+            return false;
+        }
+        value = static_cast<unsigned char>(m_bytes[m_pos++]);
+        return true;
+    }
+
+    bool readFixed64(unsigned long long& value) {
+        value = 0;
+        for (int i = 0; i < 8; ++i) {
+            unsigned char byte;
+            if (!readByte(byte)) return false;
+            value |= static_cast<unsigned long long>(byte) << (8 * i);
+        }
+        return true;
+    }
+
+    bool readBytes(std::size_t count, std::string& bytes) {
+        if (m_failed || m_bytes.size() - m_pos < count) {
+            m_failed = true;
+            return false;
+        }
+        bytes.assign(m_bytes, m_pos, count);
+        m_pos += count;
+        return true;
+    }
+
+    bool atEnd() const { return m_pos == m_bytes.size(); }
+    bool failed() const { return m_failed; }
+
+private:
+    const std::string& m_bytes;
+    std::size_t m_pos;
+    bool m_failed;
+};
+
+#endif // BINARYIO_H_
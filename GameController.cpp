@@ -5,11 +5,13 @@
 #include "GraphObject.h"
 #include "SoundFX.h"
 #include "SpriteManager.h"
+#include "RandomGenerator.h"
 #include <string>
 #include <map>
 #include <utility>
 #include <cstdlib>
 #include <algorithm>
+#include <ctime>
 using namespace std;
 
 /*
@@ -148,7 +150,9 @@ static void timerFuncCallback(int val)
 
 void GameController::run(int argc, char* argv[], GameWorld* gw, string windowTitle)
 {
-	gw->setController(this);
+	gw->setInputSource(this);
+	gw->setSoundSink(this);
+	gw->setStatusSink(this);
 	m_gw = gw;
 	setGameState(welcome);
 	m_lastKeyHit = INVALID_KEY;
@@ -187,7 +191,14 @@ void GameController::keyboardEvent(unsigned char key, int /* x */, int /* y */)
 		case 't':			m_lastKeyHit = KEY_PRESS_TAB;	break;
 		case 'f':			m_singleStep = true;			break;
 		case 'r':			m_singleStep = false;			break;
+		case 'b':
+			  // back up one tick and pause there; 'f' steps forward again, 'r' resumes.
+			  // not on the last frame of a death or a finished level: the transition is already queued
+			if (m_gameState == animate && m_nextStateAfterAnimate == not_applicable && m_gw->rewindOneTick())
+				m_singleStep = true;
+			break;
 		case 'q': case 'Q': setGameState(quit);				break;
+		case '\x03':		exit(0);						break;	// CTRL-C
 		default:			m_lastKeyHit = key;				break;
 	}
 }
@@ -237,18 +248,21 @@ void GameController::doSomething()
 			m_secondMessage = "Press Enter to continue playing...";
 			setGameState(prompt);
 			m_nextStateAfterPrompt = cleanup;
+			m_gw->prepareNextLevel();
 			break;
 		case finishedlevel:
 			m_mainMessage = "Woot! You finished the level!";
 			m_secondMessage = "Press Enter to continue playing...";
 			setGameState(prompt);
 			m_nextStateAfterPrompt = cleanup;
+			m_gw->prepareNextLevel();
 			break;
 		case makemove:
 			m_curIntraFrameTick = ANIMATION_POSITIONS_PER_TICK;
 			m_nextStateAfterAnimate = not_applicable;
 			{
 				int status = m_gw->move();
+				m_gw->advanceTick();
 				if (status == GWSTATUS_PLAYER_DIED)
 				{
 					  // animate one last frame so the player can see what happened
@@ -371,7 +385,7 @@ void GameController::displayGamePlay()
 
 	for (int i = NUM_LAYERS - 1; i >= 0; --i)
 	{
-		std::set<GraphObject*> &graphObjects = GraphObject::getGraphObjects(i);
+		const std::vector<GraphObject*>& graphObjects = m_gw->getGraphObjectRegistry().getLayer(i);
 
 		for (auto it = graphObjects.begin(); it != graphObjects.end(); it++)
 		{
@@ -479,11 +493,12 @@ static void drawPrompt(string mainMessage, string secondMessage)
 static void drawScoreAndLives(string gameStatText)
 {
 	static int RATE = 1;
+	static RandomGenerator jitter(static_cast<unsigned long long>(time(nullptr)));
 	static GLfloat rgb[3] =
 		{ static_cast<GLfloat>(.6), static_cast<GLfloat>(.6), static_cast<GLfloat>(.6) };
 	for (int k = 0; k < 3; k++)
 	{
-		double strength = rgb[k] + (-RATE + rand() % (2*RATE+1)) / 100.0;
+		double strength = rgb[k] + (-RATE + jitter.nextInt(2*RATE+1)) / 100.0;
 		if (strength < .6)
 			strength = .6;
 		else if (strength > 1.0)
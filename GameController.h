@@ -2,6 +2,7 @@
 #define GAMECONTROLLER_H_
 
 #include "SpriteManager.h"
+#include "GameWorld.h"
 #include <string>
 #include <map>
 #include <iostream>
@@ -14,14 +15,13 @@ enum GameControllerState {
 const int INVALID_KEY = 0;
 
 class GraphObject;
-class GameWorld;
 
-class GameController
+class GameController : public InputSource, public SoundSink, public StatusSink
 {
   public:
 	void run(int argc, char* argv[], GameWorld* gw, std::string windowTitle);
 
-	bool getLastKey(int& value)
+	virtual bool getLastKey(int& value)
 	{
 		if (m_lastKeyHit != INVALID_KEY)
 		{
@@ -32,9 +32,9 @@ class GameController
 		return false;
 	}
 
-	void playSound(int soundID);
+	virtual void playSound(int soundID);
 
-	void setGameStatText(std::string text)
+	virtual void setGameStatText(std::string text)
 	{
 		m_gameStatText = text;
 	}
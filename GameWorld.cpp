@@ -1,29 +1,24 @@
 #include "GameWorld.h"
-#include "GameController.h"
 #include <string>
-#include <cstdlib>
 using namespace std;
 
 bool GameWorld::getKey(int& value)
 {
-	bool gotKey = m_controller->getLastKey(value);
+	bool gotKey = m_input != nullptr && m_input->getLastKey(value);
 
-	if (gotKey)
-	{
-		if (value == 'q')
-			m_controller->quitGame();
-		else if (value == '\x03')  // CTRL-C
-			exit(0);
-	}
+	if (gotKey && m_recorder != nullptr)
+		m_recorder->recordKey(m_tick, value);
 	return gotKey;
 }
 
 void GameWorld::playSound(int soundID)
 {
-	m_controller->playSound(soundID);
+	if (m_sound != nullptr)
+		m_sound->playSound(soundID);
 }
 
 void GameWorld::setGameStatText(string text)
 {
-	m_controller->setGameStatText(text);
+	if (m_status != nullptr)
+		m_status->setGameStatText(text);
 }
@@ -2,11 +2,55 @@
 #define GAMEWORLD_H_
 
 #include "GameConstants.h"
+#include "GraphObject.h"
 #include <string>
 
 const int START_PLAYER_LIVES = 3;
 
-class GameController;
+  // A GameWorld reaches the outside world only through these three interfaces.
+  // The GameController implements all of them; a headless host can plug in its
+  // own, and any that is left unset is simply a no-op.
+
+class InputSource
+{
+public:
+	virtual ~InputSource()
+	{
+	}
+
+	virtual bool getLastKey(int& value) = 0;
+};
+
+class SoundSink
+{
+public:
+	virtual ~SoundSink()
+	{
+	}
+
+	virtual void playSound(int soundID) = 0;
+};
+
+class StatusSink
+{
+public:
+	virtual ~StatusSink()
+	{
+	}
+
+	virtual void setGameStatText(std::string text) = 0;
+};
+
+  // Sees every key the world consumes, stamped with the tick it was read on.
+class InputRecorder
+{
+public:
+	virtual ~InputRecorder()
+	{
+	}
+
+	virtual void recordKey(unsigned long tick, int key) = 0;
+};
 
 class GameWorld
 {
@@ -14,7 +58,8 @@ public:
 
 	GameWorld(std::string assetDir)
 	 : m_lives(START_PLAYER_LIVES), m_score(0), m_level(0),
-	   m_controller(nullptr), m_assetDir(assetDir)
+	   m_input(nullptr), m_sound(nullptr), m_status(nullptr), m_recorder(nullptr),
+	   m_tick(0), m_assetDir(assetDir)
 	{
 	}
 
@@ -26,6 +71,24 @@ public:
 	virtual int move() = 0;
 	virtual void cleanUp() = 0;
 
+	  // Called while a between-level prompt is up so the next init() can start
+	  // from work done in the background.  The default does nothing.
+	virtual void prepareNextLevel()
+	{
+	}
+
+	  // Puts the world back the way it was before the last move(), if it kept
+	  // that state.  The default keeps no history and returns false.
+	virtual bool rewindOneTick()
+	{
+		return false;
+	}
+
+	  // Seeds the world's gameplay randomness.  The default does nothing.
+	virtual void setRandomSeed(unsigned long long /* seed */)
+	{
+	}
+
 	void setGameStatText(std::string text);
 
 	bool getKey(int& value);
@@ -72,23 +135,69 @@ public:
 	{
 		++m_level;
 	}
+
+	  // Number of move() calls since the world was created; bumped after each one.
+	unsigned long getTick() const
+	{
+		return m_tick;
+	}
+
+	void advanceTick()
+	{
+		++m_tick;
+	}
+
+	  // Puts the counters back the way a saved snapshot had them.
+	void restoreCounters(unsigned int lives, unsigned int score, unsigned int level, unsigned long tick)
+	{
+		m_lives = lives;
+		m_score = score;
+		m_level = level;
+		m_tick = tick;
+	}
    
-	void setController(GameController* controller)
+	void setInputSource(InputSource* input)
+	{
+		m_input = input;
+	}
+
+	void setSoundSink(SoundSink* sound)
+	{
+		m_sound = sound;
+	}
+
+	void setStatusSink(StatusSink* status)
+	{
+		m_status = status;
+	}
+
+	void setInputRecorder(InputRecorder* recorder)
 	{
-		m_controller = controller;
+		m_recorder = recorder;
 	}
 
 	std::string assetDirectory() const
 	{
 		return m_assetDir;
 	}
+
+	  // Everything this world wants drawn
+	GraphObjectRegistry& getGraphObjectRegistry()
+	{
+		return m_graphObjects;
+	}
 	
 private:
 	unsigned int	m_lives;
 	unsigned int	m_score;
 	unsigned int	m_level;
-	GameController* m_controller;
+	InputSource*	m_input;
+	SoundSink*		m_sound;
+	StatusSink*		m_status;
+	InputRecorder*	m_recorder;
+	unsigned long	m_tick;
 	std::string		m_assetDir;
+	GraphObjectRegistry m_graphObjects;
 };
 
 #endif // GAMEWORLD_H_
@@ -1,15 +1,62 @@
 #ifndef GRAPHOBJ_H_
 #define GRAPHOBJ_H_
 
-#include "SpriteManager.h"
 #include "GameConstants.h"
 
-#include <set>
+#include <vector>
 #include <cmath>
 
 const int ANIMATION_POSITIONS_PER_TICK = 1;
 const int NUM_LAYERS = 4;
 
+class GraphObject;
+
+  // The GraphObjects a renderer draws, one list per depth layer.  Each world
+  // owns one, so several worlds can share a process without corrupting each
+  // other's render lists.  Objects created without a registry go into a
+  // process-wide one, which is kept only for compatibility and can be turned
+  // off (do that before any objects exist).
+class GraphObjectRegistry
+{
+  public:
+	GraphObjectRegistry()
+	{
+	}
+
+	const std::vector<GraphObject*>& getLayer(unsigned int layer) const
+	{
+		return m_layers[layer < NUM_LAYERS ? layer : 0];
+	}
+
+	inline void add(GraphObject* obj);
+	inline void remove(GraphObject* obj);
+
+	  // nullptr when the global registry is disabled
+	static GraphObjectRegistry* global()
+	{
+		static GraphObjectRegistry registry;
+		return globalEnabled() ? &registry : nullptr;
+	}
+
+	static void setGlobalEnabled(bool enabled)
+	{
+		globalEnabled() = enabled;
+	}
+
+  private:
+	  // Prevent copying or assigning registries
+	GraphObjectRegistry(const GraphObjectRegistry&);
+	GraphObjectRegistry& operator=(const GraphObjectRegistry&);
+
+	std::vector<GraphObject*> m_layers[NUM_LAYERS];
+
+	static bool& globalEnabled()
+	{
+		static bool enabled = true;
+		return enabled;
+	}
+};
+
 inline int roundAwayFromZero(double r)
 {
 	double result =	 r > 0 ? std::floor(r + 0.5) : std::ceil(r - 0.5);
@@ -23,20 +70,37 @@ class GraphObject
 
 	enum Direction { none, up, down, left, right };
 
-	GraphObject(int imageID, int startX, int startY, Direction dir = right, double size = 1.0, unsigned int depth = 0)
+	GraphObject(int imageID, int startX, int startY, Direction dir = right, double size = 1.0, unsigned int depth = 0,
+				GraphObjectRegistry* registry = nullptr)
 	 : m_imageID(imageID), m_visible(false), m_x(startX), m_y(startY),
 	   m_destX(startX), m_destY(startY), m_brightness(1.0),
-	   m_animationNumber(0), m_direction(dir), m_size(size), m_depth(depth)
+	   m_animationNumber(0), m_direction(dir), m_size(size), m_depth(depth),
+	   m_registry(registry != nullptr ? registry : GraphObjectRegistry::global()), m_registryIndex(0)
 	{
 		if (m_size <= 0)
 			m_size = 1;
 
-		getGraphObjects(m_depth).insert(this);
+		if (m_registry != nullptr)
+			m_registry->add(this);
+	}
+
+	  // A copy of another object's state that belongs to the given registry
+	  // instead of the original's.  Used when a whole world is cloned.
+	GraphObject(const GraphObject& other, GraphObjectRegistry* registry)
+	 : m_imageID(other.m_imageID), m_visible(other.m_visible), m_x(other.m_x), m_y(other.m_y),
+	   m_destX(other.m_destX), m_destY(other.m_destY), m_brightness(other.m_brightness),
+	   m_animationNumber(other.m_animationNumber), m_direction(other.m_direction), m_size(other.m_size),
+	   m_depth(other.m_depth),
+	   m_registry(registry != nullptr ? registry : GraphObjectRegistry::global()), m_registryIndex(0)
+	{
+		if (m_registry != nullptr)
+			m_registry->add(this);
 	}
 
 	virtual ~GraphObject()
 	{
-		getGraphObjects(m_depth).erase(this);
+		if (m_registry != nullptr)
+			m_registry->remove(this);
 	}
 
 	void setVisible(bool shouldIDisplay)
@@ -68,6 +132,15 @@ class GraphObject
 		increaseAnimationNumber();
 	}
 
+	  // Like moveTo, but also jumps the animated position so the object is not
+	  // drawn sliding over from where it was.
+	void teleportTo(int x, int y)
+	{
+		moveTo(x, y);
+		m_x = x;
+		m_y = y;
+	}
+
 	Direction getDirection() const
 	{
 		return m_direction;
@@ -118,16 +191,18 @@ class GraphObject
 		moveALittle(m_y, m_destY);
 	}
 
-	static std::set<GraphObject*>& getGraphObjects(unsigned int layer)
+	  // Compatibility access to the process-wide registry's layers; empty when
+	  // it is disabled.
+	static const std::vector<GraphObject*>& getGraphObjects(unsigned int layer)
 	{
-		static std::set<GraphObject*> graphObjects[NUM_LAYERS];
-		if (layer < NUM_LAYERS)
-			return graphObjects[layer];
-		else
-			return graphObjects[0];		// empty;
+		static const std::vector<GraphObject*> none;
+		GraphObjectRegistry* registry = GraphObjectRegistry::global();
+		return registry != nullptr ? registry->getLayer(layer) : none;
 	}
 
   private:
+	friend class GraphObjectRegistry;
+
 	  // Prevent copying or assigning GraphObjects
 	GraphObject(const GraphObject&);
 	GraphObject& operator=(const GraphObject&);
@@ -143,6 +218,8 @@ class GraphObject
 	Direction	m_direction;
 	double	m_size;
 	int		m_depth;
+	GraphObjectRegistry* m_registry;
+	size_t	m_registryIndex;
 
 	void moveALittle(double& from, double& to)
 	{
@@ -161,4 +238,20 @@ class GraphObject
 	}
 };
 
+inline void GraphObjectRegistry::add(GraphObject* obj)
+{
+	std::vector<GraphObject*>& layer = m_layers[obj->m_depth < NUM_LAYERS ? obj->m_depth : 0];
+	obj->m_registryIndex = layer.size();
+	layer.push_back(obj);
+}
+
+inline void GraphObjectRegistry::remove(GraphObject* obj)
+{
+	std::vector<GraphObject*>& layer = m_layers[obj->m_depth < NUM_LAYERS ? obj->m_depth : 0];
+	GraphObject* moved = layer.back();
+	layer[obj->m_registryIndex] = moved;
+	moved->m_registryIndex = obj->m_registryIndex;
+	layer.pop_back();
+}
+
 #endif // GRAPHOBJ_H_
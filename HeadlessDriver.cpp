@@ -0,0 +1,116 @@
+#include "HeadlessDriver.h"
+#include "StudentWorld.h"
+#include <chrono>
+using namespace std;
+
+namespace {
+    const int SCRIPTED_KEYS[] = { KEY_PRESS_LEFT, KEY_PRESS_RIGHT, KEY_PRESS_UP, KEY_PRESS_DOWN,
+                                  KEY_PRESS_SPACE, KEY_PRESS_TAB, 'z' };
+    const int NUM_SCRIPTED_KEYS = sizeof(SCRIPTED_KEYS) / sizeof(SCRIPTED_KEYS[0]);
+}
+
+RandomKeyScript::RandomKeyScript(unsigned long long seed)
+    : m_random(seed) {
+}
+
+bool RandomKeyScript::keyForTick(unsigned long /* tick */, int& key) {
+    if (m_random.nextInt(3) != 0) {
+        return false;
+    }
+    key = SCRIPTED_KEYS[m_random.nextInt(NUM_SCRIPTED_KEYS)];
+    return true;
+}
+
+double DriverStats::ticksPerSecond() const {
+    return wallSeconds > 0 ? ticks / wallSeconds : 0;
+}
+
+double DriverStats::ticksPerLevel() const {
+    return levelsStarted > 0 ? static_cast<double>(ticks) / levelsStarted : 0;
+}
+
+HeadlessDriver::HeadlessDriver(StudentWorld* world, KeyScript* script)
+    : m_world(world), m_script(script), m_observer(nullptr), m_keyPending(false), m_pendingKey(0) {
+    m_world->setInputSource(this);
+}
+
+HeadlessDriver::~HeadlessDriver() {
+    m_world->setInputSource(nullptr);
+}
+
+bool HeadlessDriver::getLastKey(int& value) {
+    if (!m_keyPending) {
+        return false;
+    }
+    m_keyPending = false;
+    value = m_pendingKey;
+    return true;
+}
+
+void HeadlessDriver::startLevel(DriverStats& stats, bool afterReset) {
+    stats.levelsStarted++;
+    stats.totalLevelGenerationMicros += m_world->getLastLevelGenerationMicros();
+    if (afterReset) {
+        stats.totalResetMicros += m_world->getLastResetMicros();
+        stats.resets++;
+    }
+}
+
+DriverStats HeadlessDriver::run(unsigned long maxTicks) {
+    return play(true, maxTicks);
+}
+
+DriverStats HeadlessDriver::resume(unsigned long maxTicks) {
+    return play(false, maxTicks);
+}
+
+DriverStats HeadlessDriver::play(bool startWithInit, unsigned long maxTicks) {
+    DriverStats stats = DriverStats();
+    auto start = chrono::steady_clock::now();
+
+    bool playing = !m_world->isGameOver();
+    if (startWithInit) {
+        playing = m_world->init() == GWSTATUS_CONTINUE_GAME;
+        if (playing) {
+            startLevel(stats, false);
+        }
+    }
+    while (playing && (maxTicks == 0 || stats.ticks < maxTicks)) {
+        if (m_observer != nullptr) {
+            m_observer->beforeTick(*m_world);
+        }
+        int key;
+        if (m_script != nullptr && m_script->keyForTick(m_world->getTick(), key)) {
+            m_pendingKey = key;
+            m_keyPending = true;
+        }
+
+        int status = m_world->move();
+        m_world->advanceTick();
+        stats.ticks++;
+        if (status == GWSTATUS_CONTINUE_GAME) {
+            continue;
+        }
+
+        if (status == GWSTATUS_PLAYER_DIED) {
+            stats.livesLost++;
+            if (m_world->isGameOver()) {
+                break;
+            }
+        } else if (status == GWSTATUS_FINISHED_LEVEL) {
+            stats.levelsCompleted++;
+            m_world->advanceToNextLevel();
+        }
+        // Nothing runs between levels here, so init() builds the next layout on this thread.
+        m_world->cleanUp();
+        playing = m_world->init() == GWSTATUS_CONTINUE_GAME;
+        if (playing) {
+            startLevel(stats, true);
+        }
+    }
+
+    stats.wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    stats.finalScore = m_world->getScore();
+    stats.finalLevel = m_world->getLevel();
+    return stats;
+}
@@ -0,0 +1,78 @@
+#ifndef HEADLESSDRIVER_H_
+#define HEADLESSDRIVER_H_
+
+#include "GameWorld.h"
+#include "RandomGenerator.h"
+
+class StudentWorld;
+
+// Supplies the key (if any) pressed on each tick of a headless run.
+class KeyScript {
+public:
+    virtual ~KeyScript() {}
+    // Returns false if no key is pressed on this tick.
+    virtual bool keyForTick(unsigned long tick, int& key) = 0;
+};
+
+// Presses one of TunnelMan's keys on roughly a third of the ticks.
+class RandomKeyScript : public KeyScript {
+public:
+    explicit RandomKeyScript(unsigned long long seed);
+    virtual bool keyForTick(unsigned long tick, int& key) override;
+
+private:
+    RandomGenerator m_random;
+};
+
+// Sees the world between ticks: after init() or the previous move, before the next key is chosen.
+class TickObserver {
+public:
+    virtual ~TickObserver() {}
+    virtual void beforeTick(StudentWorld& world) = 0;
+};
+
+struct DriverStats {
+    unsigned long ticks;
+    unsigned long levelsStarted;
+    unsigned long levelsCompleted;
+    unsigned long livesLost;
+    unsigned int finalScore;
+    unsigned int finalLevel;
+    double wallSeconds;
+    long long totalLevelGenerationMicros;
+    long long totalResetMicros;
+    unsigned long resets;
+
+    double ticksPerSecond() const;
+    double ticksPerLevel() const;
+};
+
+// Runs a world's init/move/cleanUp cycle back to back, the way GameController does between
+// prompts, but with no rendering, animation frames or waits. Keys come from a KeyScript.
+class HeadlessDriver : public InputSource {
+public:
+    HeadlessDriver(StudentWorld* world, KeyScript* script);
+    virtual ~HeadlessDriver();
+
+    // Plays until the game ends or maxTicks moves have run (0 means no limit).
+    DriverStats run(unsigned long maxTicks = 0);
+    // Like run(), but carries on from the world's current state (a restored snapshot, say)
+    // instead of starting with init().
+    DriverStats resume(unsigned long maxTicks = 0);
+
+    void setTickObserver(TickObserver* observer) { m_observer = observer; }
+
+    virtual bool getLastKey(int& value) override;
+
+private:
+    StudentWorld* m_world;
+    KeyScript* m_script;
+    TickObserver* m_observer;
+    bool m_keyPending;
+    int m_pendingKey;
+
+    void startLevel(DriverStats& stats, bool afterReset);
+    DriverStats play(bool startWithInit, unsigned long maxTicks);
+};
+
+#endif // HEADLESSDRIVER_H_
@@ -0,0 +1,119 @@
+#include "LevelGenerator.h"
+#include "StudentWorld.h"
+#include "Proximity.h"
+#include "RandomGenerator.h"
+#include <algorithm>
+#include <chrono>
+using namespace std;
+
+static_assert(LAYOUT_EARTH_COLUMNS == OIL_FIELD_WIDTH, "layout earth columns must cover the oil field");
+
+namespace {
+    const int PLACEMENT_SPACING = 6;
+    const int PLACEMENT_COLUMNS = OIL_FIELD_WIDTH - SPRITE_WIDTH + 1;
+    const int PLACEMENT_ROWS = GAME_BOARD_HEIGHT - SPRITE_HEIGHT + 1;
+    const int TUNNELMAN_START_X = 30;
+    const int TUNNELMAN_START_Y = 60;
+
+    class PlacementGrid {
+    public:
+        PlacementGrid() : m_blocked(PLACEMENT_COLUMNS * PLACEMENT_ROWS, false) {}
+
+        bool isBlocked(int x, int y) const {
+            return m_blocked[x * PLACEMENT_ROWS + y];
+        }
+
+        // Marks every position within PLACEMENT_SPACING of (x, y) as unusable.
+        void exclude(int x, int y) {
+            const RadiusStencil& disc = PROXIMITY_STENCILS[PLACEMENT_SPACING];
+            for (int dy = -PLACEMENT_SPACING; dy <= PLACEMENT_SPACING; ++dy) {
+                int row = y + dy;
+                if (row < 0 || row >= PLACEMENT_ROWS) continue;
+                int halfWidth = disc.halfWidth(dy);
+                int first = std::max(0, x - halfWidth);
+                int last = std::min(PLACEMENT_COLUMNS - 1, x + halfWidth);
+                for (int col = first; col <= last; ++col) {
+                    m_blocked[col * PLACEMENT_ROWS + row] = true;
+                }
+            }
+        }
+
+    private:
+        std::vector<bool> m_blocked;
+    };
+
+    bool overlapsShaftColumns(int x) {
+        return x + SPRITE_WIDTH - 1 >= TUNNEL_SHAFT_X_START && x <= TUNNEL_SHAFT_X_END;
+    }
+
+    bool overlapsShaft(int x, int y) {
+        return overlapsShaftColumns(x) &&
+               y + SPRITE_HEIGHT - 1 >= TUNNEL_SHAFT_Y_BOTTOM_NO_EARTH && y <= TUNNEL_SHAFT_Y_TOP;
+    }
+
+    void placeObjects(int count, std::vector<LevelObject>& candidates, PlacementGrid& grid,
+                      RandomGenerator& rng, std::vector<LevelObject>& placed) {
+        while (static_cast<int>(placed.size()) < count && !candidates.empty()) {
+            size_t pick = rng.nextInt(static_cast<int>(candidates.size()));
+            LevelObject spot = candidates[pick];
+            candidates[pick] = candidates.back();
+            candidates.pop_back();
+            if (grid.isBlocked(spot.x, spot.y)) continue;
+
+            placed.push_back(spot);
+            grid.exclude(spot.x, spot.y);
+        }
+    }
+}
+
+LevelLayout generateLevelLayout(int level, unsigned long long seed) {
+    auto start = std::chrono::steady_clock::now();
+    LevelLayout layout;
+    layout.level = level;
+    RandomGenerator rng(seed);
+
+    PlacementGrid grid;
+    grid.exclude(TUNNELMAN_START_X, TUNNELMAN_START_Y);
+
+    std::vector<LevelObject> candidates;
+    candidates.reserve(PLACEMENT_COLUMNS * PLACEMENT_ROWS);
+
+    // Boulders sit in rows 20-56 and never in the shaft's columns.
+    for (int x = 0; x < PLACEMENT_COLUMNS; ++x) {
+        for (int y = 20; y <= 56; ++y) {
+            if (!overlapsShaftColumns(x)) candidates.push_back(LevelObject{ x, y });
+        }
+    }
+    placeObjects(std::min(level / 2 + 2, 9), candidates, grid, rng, layout.boulders);
+
+    // Gold and barrels may go anywhere under the surface outside the shaft.
+    std::vector<LevelObject> buried;
+    buried.reserve(PLACEMENT_COLUMNS * PLACEMENT_ROWS);
+    for (int x = 0; x < PLACEMENT_COLUMNS; ++x) {
+        for (int y = 0; y <= EARTH_FIELD_HEIGHT - SPRITE_HEIGHT; ++y) {
+            if (!overlapsShaft(x, y)) buried.push_back(LevelObject{ x, y });
+        }
+    }
+    candidates = buried;
+    placeObjects(std::max(5 - level / 2, 2), candidates, grid, rng, layout.gold);
+    candidates = buried;
+    placeObjects(std::min(2 + level, 21), candidates, grid, rng, layout.barrels);
+
+    const unsigned long long fullColumn = (1ULL << EARTH_FIELD_HEIGHT) - 1;
+    const unsigned long long shaftColumn = fullColumn & ~((1ULL << TUNNEL_SHAFT_Y_BOTTOM_NO_EARTH) - 1);
+    for (int x = 0; x < OIL_FIELD_WIDTH; ++x) {
+        layout.earthColumns[x] = fullColumn;
+        if (x >= TUNNEL_SHAFT_X_START && x <= TUNNEL_SHAFT_X_END) {
+            layout.earthColumns[x] &= ~shaftColumn;
+        }
+    }
+    for (const LevelObject& boulder : layout.boulders) {
+        for (int i = 0; i < SPRITE_WIDTH; ++i) {
+            layout.earthColumns[boulder.x + i] &= ~(((1ULL << SPRITE_HEIGHT) - 1) << boulder.y);
+        }
+    }
+
+    layout.generationMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    return layout;
+}
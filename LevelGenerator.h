@@ -0,0 +1,34 @@
+#ifndef LEVELGENERATOR_H_
+#define LEVELGENERATOR_H_
+
+#include <vector>
+
+const int LAYOUT_EARTH_COLUMNS = 64;
+
+struct LevelObject {
+    int x, y;
+};
+
+// Everything placement decides for one level, kept as plain data so it can be produced away from
+// the world that will use it (see StudentWorld::prepareNextLevel). Bit y of earthColumns[x] is set
+// where earth is left once the shaft and the squares under the boulders are cleared.
+struct LevelLayout {
+    int level;
+    std::vector<LevelObject> boulders;
+    std::vector<LevelObject> gold;
+    std::vector<LevelObject> barrels;
+    unsigned long long earthColumns[LAYOUT_EARTH_COLUMNS];
+    long long generationMicros;
+};
+
+// Places boulders, gold and barrels so that no two objects (or an object and TunnelMan's start
+// position) are within 6 squares of each other, and nothing overlaps the tunnel shaft.
+//
+// Every legal position for an object kind goes into a candidate list. A placement stamps its
+// exclusion disc into a background grid, and a candidate drawn from inside a disc is swapped out
+// of the list rather than redrawn, so each candidate is looked at most once and a level costs a
+// bounded amount of work however crowded it gets. Picks are uniform over the positions still
+// legal, the same distribution the old rejection loop produced.
+LevelLayout generateLevelLayout(int level, unsigned long long seed);
+
+#endif // LEVELGENERATOR_H_
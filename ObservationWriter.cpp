@@ -0,0 +1,104 @@
+#include "ObservationWriter.h"
+#include "StudentWorld.h"
+#include "GameConstants.h"
+#include <algorithm>
+#include <cstring>
+using namespace std;
+
+namespace {
+    unsigned int packStamp(int kind, int x, int y) {
+        return (static_cast<unsigned int>(kind) << 16) | (static_cast<unsigned int>(y & 0xFF) << 8) |
+               static_cast<unsigned int>(x & 0xFF);
+    }
+}
+
+ObservationWriter::ObservationWriter(unsigned char* grid, bool includeHidden)
+    : m_grid(grid), m_includeHidden(includeHidden), m_valid(false), m_lastCellsWritten(0) {
+}
+
+void ObservationWriter::setGrid(unsigned char* grid) {
+    m_grid = grid;
+    invalidate();
+}
+
+void ObservationWriter::invalidate() {
+    m_valid = false;
+}
+
+void ObservationWriter::write(const StudentWorld& world) {
+    m_lastCellsWritten = 0;
+    if (!m_valid) {
+        memset(m_grid, 0, OBSERVATION_BYTES);
+        for (int x = 0; x < GRID_WIDTH; ++x) {
+            m_earthColumns[x] = 0;
+        }
+        m_stamps.clear();
+        m_valid = true;
+        m_lastCellsWritten = OBSERVATION_BYTES;
+    }
+
+    unsigned char* earth = m_grid + Actor::KIND_EARTH * CHANNEL_SIZE;
+    const unsigned long long* columns = world.getEarthColumns();
+    for (int x = 0; x < GRID_WIDTH; ++x) {
+        unsigned long long changed = m_earthColumns[x] ^ columns[x];
+        for (int y = 0; changed != 0; ++y, changed >>= 1) {
+            if (changed & 1) {
+                earth[y * GRID_WIDTH + x] = static_cast<unsigned char>((columns[x] >> y) & 1);
+                ++m_lastCellsWritten;
+            }
+        }
+        m_earthColumns[x] = columns[x];
+    }
+
+    m_nextStamps.clear();
+    const TunnelMan* tunnelman = world.getTunnelMan();
+    if (tunnelman != nullptr && tunnelman->isVisible()) {
+        m_nextStamps.push_back(
+            make_pair(tunnelman, packStamp(Actor::KIND_TUNNELMAN, tunnelman->getX(), tunnelman->getY())));
+    }
+    for (const Actor* actor : world.getActors()) {
+        if (m_includeHidden || actor->isVisible()) {
+            m_nextStamps.push_back(
+                make_pair(actor, packStamp(actor->getKind(), actor->getX(), actor->getY())));
+        }
+    }
+    sort(m_nextStamps.begin(), m_nextStamps.end());
+
+    // Merge by actor: one that died or appeared is erased or stamped alone, and one that stayed
+    // is redrawn only if its stamp differs. An address reused by a new actor is still right, as
+    // the planes hold counts and only the stamps' sum matters.
+    StampList::const_iterator before = m_stamps.begin();
+    StampList::const_iterator after = m_nextStamps.begin();
+    while (before != m_stamps.end() || after != m_nextStamps.end()) {
+        if (after == m_nextStamps.end() || (before != m_stamps.end() && before->first < after->first)) {
+            stamp(before->second, -1);
+            ++before;
+        } else if (before == m_stamps.end() || after->first < before->first) {
+            stamp(after->second, 1);
+            ++after;
+        } else {
+            if (before->second != after->second) {
+                stamp(before->second, -1);
+                stamp(after->second, 1);
+            }
+            ++before;
+            ++after;
+        }
+    }
+    m_stamps.swap(m_nextStamps);
+}
+
+void ObservationWriter::stamp(unsigned int packed, int delta) {
+    unsigned char* plane = m_grid + (packed >> 16) * CHANNEL_SIZE;
+    int x0 = packed & 0xFF;
+    int y0 = (packed >> 8) & 0xFF;
+    int x1 = x0 + SPRITE_WIDTH < GRID_WIDTH ? x0 + SPRITE_WIDTH : GRID_WIDTH;
+    int y1 = y0 + SPRITE_HEIGHT < GRID_HEIGHT ? y0 + SPRITE_HEIGHT : GRID_HEIGHT;
+    for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+            unsigned char& cell = plane[y * GRID_WIDTH + x];
+            cell = static_cast<unsigned char>(cell + delta);
+        }
+    }
+    m_lastCellsWritten += (x1 - x0) * (y1 - y0);
+}
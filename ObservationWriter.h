@@ -0,0 +1,54 @@
+#ifndef OBSERVATIONWRITER_H_
+#define OBSERVATIONWRITER_H_
+
+#include "Actor.h"
+#include <utility>
+#include <vector>
+
+class StudentWorld;
+
+// Keeps a caller-owned grid up to date with what a world looks like, one 64 x 64 plane of bytes
+// per Actor::Kind: plane k, row y, column x is grid[k * CHANNEL_SIZE + y * GRID_WIDTH + x].
+// The earth plane holds 1 where there is earth; every other plane counts the objects of that
+// kind whose 4 x 4 sprite covers the cell. Hidden goodies are left out unless asked for.
+//
+// write() only touches what changed since the last call: earth columns are diffed against the
+// world's bitmasks, and actors are matched to their last stamp by identity, so only the ones that
+// moved, appeared, vanished or changed visibility are erased and stamped again. Anything that
+// replaces the state (a new level, a restored snapshot, a different world) is picked up the same
+// way, at worst by redrawing every actor.
+class ObservationWriter {
+public:
+    static const int GRID_WIDTH = 64;
+    static const int GRID_HEIGHT = 64;
+    static const int CHANNEL_SIZE = GRID_WIDTH * GRID_HEIGHT;
+    static const int NUM_CHANNELS = Actor::KIND_HARDCORE_PROTESTER + 1;
+    static const int OBSERVATION_BYTES = NUM_CHANNELS * CHANNEL_SIZE;
+
+    explicit ObservationWriter(unsigned char* grid = nullptr, bool includeHidden = false);
+
+    // Points the writer at another grid; the next write() clears it and draws everything.
+    void setGrid(unsigned char* grid);
+    unsigned char* getGrid() const { return m_grid; }
+    // Makes the next write() start over, for when the grid's contents were changed elsewhere.
+    void invalidate();
+
+    void write(const StudentWorld& world);
+
+    // Cells changed by the last write().
+    int getLastCellsWritten() const { return m_lastCellsWritten; }
+
+private:
+    unsigned char* m_grid;
+    bool m_includeHidden;
+    bool m_valid;
+    unsigned long long m_earthColumns[GRID_WIDTH];    // the earth plane as last written
+    typedef std::vector<std::pair<const Actor*, unsigned int> > StampList;
+    StampList m_stamps;                               // (kind, y, x) per actor as last written,
+    StampList m_nextStamps;                           // sorted by actor
+    int m_lastCellsWritten;
+
+    void stamp(unsigned int packed, int delta);
+};
+
+#endif // OBSERVATIONWRITER_H_
@@ -0,0 +1,140 @@
+#include "PathCache.h"
+#include "BinaryIO.h"
+using namespace std;
+
+PathCache::PathCache(size_t capacity)
+    : m_capacity(capacity == 0 ? 1 : capacity), m_hits(0), m_misses(0) {
+}
+
+PathCache::PathCache(const PathCache& other)
+    : m_capacity(other.m_capacity), m_entries(other.m_entries), m_hits(other.m_hits), m_misses(other.m_misses) {
+    for (EntryList::iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+        m_index[it->first] = it;
+    }
+}
+
+PathCache::PathCache(const PathCache& other, unsigned long version)
+    : m_capacity(other.m_capacity), m_hits(other.m_hits), m_misses(other.m_misses) {
+    for (EntryList::const_iterator it = other.m_entries.begin();
+         it != other.m_entries.end() && it->first.version == version; ++it) {
+        m_entries.push_back(*it);
+        m_index[it->first] = prev(m_entries.end());
+    }
+}
+
+PathCache& PathCache::operator=(const PathCache& other) {
+    if (this != &other) {
+        m_capacity = other.m_capacity;
+        m_entries = other.m_entries;
+        m_hits = other.m_hits;
+        m_misses = other.m_misses;
+        m_index.clear();
+        for (EntryList::iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+            m_index[it->first] = it;
+        }
+    }
+    return *this;
+}
+
+size_t PathCache::KeyHash::operator()(const Key& key) const {
+    unsigned long long h = static_cast<unsigned long long>(key.version) * 0x9E3779B97F4A7C15ULL;
+    h ^= static_cast<unsigned long long>((key.startX << 6) | key.startY) * 0xBF58476D1CE4E5B9ULL;
+    h ^= static_cast<unsigned long long>((key.endX << 6) | key.endY) * 0x94D049BB133111EBULL;
+    h ^= static_cast<unsigned long long>((key.limit << 3) | key.kind);
+    return static_cast<size_t>(h ^ (h >> 31));
+}
+
+bool PathCache::lookup(const Key& key, int& value) {
+    auto it = m_index.find(key);
+    if (it == m_index.end()) {
+        ++m_misses;
+        return false;
+    }
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    value = it->second->second;
+    ++m_hits;
+    return true;
+}
+
+void PathCache::store(const Key& key, int value) {
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        it->second->second = value;
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return;
+    }
+    if (m_entries.size() >= m_capacity) {
+        m_index.erase(m_entries.back().first);
+        m_entries.pop_back();
+    }
+    m_entries.push_front(make_pair(key, value));
+    m_index[key] = m_entries.begin();
+}
+
+void PathCache::clear() {
+    m_entries.clear();
+    m_index.clear();
+}
+
+// Current entries are all in front of the stale ones, so the scan stops at the first stale one.
+void PathCache::save(ByteWriter& out, unsigned long version) const {
+    EntryList::const_iterator end = m_entries.begin();
+    size_t count = 0;
+    while (end != m_entries.end() && end->first.version == version) {
+        ++end;
+        ++count;
+    }
+    out.writeVarint(count);
+    while (end != m_entries.begin()) {
+        --end;
+        const Key& key = end->first;
+        out.writeByte(static_cast<unsigned char>(key.kind));
+        out.writeByte(static_cast<unsigned char>(key.startX));
+        out.writeByte(static_cast<unsigned char>(key.startY));
+        out.writeByte(static_cast<unsigned char>(key.endX));
+        out.writeByte(static_cast<unsigned char>(key.endY));
+        out.writeInt(key.limit);
+        out.writeInt(end->second);
+    }
+}
+
+// Reuses the existing list nodes where it can; only the index is rebuilt from scratch.
+bool PathCache::load(ByteReader& in, unsigned long version) {
+    unsigned long long count;
+    if (!in.readVarint(count) || count > m_capacity) {
+        clear();
+        return false;
+    }
+    m_entries.resize(static_cast<size_t>(count));
+    m_index.clear();
+    for (EntryList::reverse_iterator it = m_entries.rbegin(); it != m_entries.rend(); ++it) {
+        Key& key = it->first;
+        unsigned char kind, startX, startY, endX, endY;
+        if (!in.readByte(kind) || !in.readByte(startX) || !in.readByte(startY) || !in.readByte(endX) ||
+            !in.readByte(endY) || !in.readInt(key.limit) || !in.readInt(it->second)) {
+            clear();
+            return false;
+        }
+        key.version = version;
+        key.kind = kind;
+        key.startX = startX;
+        key.startY = startY;
+        key.endX = endX;
+        key.endY = endY;
+        if (!m_index.insert(make_pair(key, prev(it.base()))).second) {
+            clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+double PathCache::getHitRate() const {
+    unsigned long total = m_hits + m_misses;
+    return total == 0 ? 0.0 : static_cast<double>(m_hits) / total;
+}
+
+void PathCache::resetStats() {
+    m_hits = 0;
+    m_misses = 0;
+}
@@ -0,0 +1,70 @@
+#ifndef PATHCACHE_H_
+#define PATHCACHE_H_
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+class ByteWriter;
+class ByteReader;
+
+// Small LRU cache for pathfinding results. Entries are keyed by the world's topology
+// version, so anything computed before the last dig or boulder move simply stops matching
+// and ages out.
+class PathCache {
+public:
+    enum QueryKind { FIRST_STEP, DISTANCE, BOUNDED };
+
+    struct Key {
+        unsigned long version;
+        int kind;
+        int startX, startY;
+        int endX, endY;
+        int limit;
+
+        bool operator==(const Key& other) const {
+            return version == other.version && kind == other.kind &&
+                   startX == other.startX && startY == other.startY &&
+                   endX == other.endX && endY == other.endY && limit == other.limit;
+        }
+    };
+
+    explicit PathCache(std::size_t capacity = 512);
+    // Copies entries and recency order; the index is rebuilt to point into the new list.
+    PathCache(const PathCache& other);
+    // Copies only the entries made at the given topology version, the ones save() would write.
+    PathCache(const PathCache& other, unsigned long version);
+    PathCache& operator=(const PathCache& other);
+
+    bool lookup(const Key& key, int& value);
+    void store(const Key& key, int value);
+    void clear();
+
+    // Writes the entries made at the given topology version, oldest first; load() replaces the
+    // contents with them and keeps the recency order. Older entries can never match again, and
+    // since only a hit or a store moves an entry forward they sit behind these and are evicted
+    // first, so leaving them out changes no later lookup.
+    void save(ByteWriter& out, unsigned long version) const;
+    bool load(ByteReader& in, unsigned long version);
+
+    unsigned long getHits() const { return m_hits; }
+    unsigned long getMisses() const { return m_misses; }
+    double getHitRate() const;
+    void resetStats();
+
+private:
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const;
+    };
+
+    typedef std::list<std::pair<Key, int> > EntryList;
+
+    std::size_t m_capacity;
+    EntryList m_entries;
+    std::unordered_map<Key, EntryList::iterator, KeyHash> m_index;
+    unsigned long m_hits;
+    unsigned long m_misses;
+};
+
+#endif // PATHCACHE_H_
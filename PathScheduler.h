@@ -0,0 +1,61 @@
+#ifndef PATHSCHEDULER_H_
+#define PATHSCHEDULER_H_
+
+#include "GraphObject.h"
+
+// Per-requester state the scheduler carries from one tick to the next.
+struct PathRequest {
+    PathRequest() : deferred(false), lastDirection(GraphObject::none), pendingTicket(0) {}
+
+    bool deferred;
+    GraphObject::Direction lastDirection;
+    unsigned long pendingTicket;    // outstanding PathService job, 0 if none
+};
+
+// Caps the number of search nodes expanded per tick. Once the tick's budget is spent, new
+// searches are deferred and the requester keeps its last known direction. A request that was
+// deferred is always admitted on the following tick, so every requester makes progress and a
+// tick never runs more than the budget plus one search per carried-over request.
+class PathScheduler {
+public:
+    static const int DEFAULT_NODE_BUDGET = 4096;
+
+    explicit PathScheduler(int nodeBudgetPerTick = DEFAULT_NODE_BUDGET)
+        : m_nodeBudget(nodeBudgetPerTick), m_nodesThisTick(0), m_maxNodesPerTick(0), m_deferredCount(0) {
+    }
+
+    // 0 disables the budget.
+    void setNodeBudget(int nodesPerTick) { m_nodeBudget = nodesPerTick; }
+    int getNodeBudget() const { return m_nodeBudget; }
+
+    void beginTick() { m_nodesThisTick = 0; }
+
+    bool admit(PathRequest& request) {
+        if (m_nodeBudget <= 0 || m_nodesThisTick < m_nodeBudget || request.deferred) {
+            request.deferred = false;
+            return true;
+        }
+        request.deferred = true;
+        ++m_deferredCount;
+        return false;
+    }
+
+    void charge(int nodesExpanded) {
+        m_nodesThisTick += nodesExpanded;
+        if (m_nodesThisTick > m_maxNodesPerTick) {
+            m_maxNodesPerTick = m_nodesThisTick;
+        }
+    }
+
+    int getNodesThisTick() const { return m_nodesThisTick; }
+    int getMaxNodesPerTick() const { return m_maxNodesPerTick; }
+    unsigned long getDeferredCount() const { return m_deferredCount; }
+
+private:
+    int m_nodeBudget;
+    int m_nodesThisTick;
+    int m_maxNodesPerTick;
+    unsigned long m_deferredCount;
+};
+
+#endif // PATHSCHEDULER_H_
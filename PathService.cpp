@@ -0,0 +1,140 @@
+#include "PathService.h"
+#include <algorithm>
+#include <cstdlib>
+using namespace std;
+
+namespace {
+
+const int STEP_DX[] = {0, 0, -1, 1};
+const int STEP_DY[] = {1, -1, 0, 0};
+
+}
+
+PathService::PathService(int threadCount)
+    : m_outstanding(0), m_nextTicket(1), m_stopping(false) {
+    if (threadCount <= 0) {
+        threadCount = max(1, static_cast<int>(thread::hardware_concurrency()) - 1);
+    }
+    for (int i = 0; i < threadCount; ++i) {
+        m_workers.push_back(thread(&PathService::workerLoop, this));
+    }
+}
+
+PathService::~PathService() {
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobReady.notify_all();
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+        m_workers[i].join();
+    }
+}
+
+unsigned long PathService::submit(const shared_ptr<const WalkabilitySnapshot>& snapshot,
+                                  int startX, int startY, int endX, int endY, int maxSteps) {
+    Job job;
+    job.snapshot = snapshot;
+    job.result.version = snapshot->version;
+    job.result.startX = startX;
+    job.result.startY = startY;
+    job.result.endX = endX;
+    job.result.endY = endY;
+    job.result.maxSteps = maxSteps;
+    job.result.firstStep = -1;
+    {
+        lock_guard<mutex> lock(m_mutex);
+        job.ticket = m_nextTicket++;
+        m_queue.push_back(job);
+        ++m_outstanding;
+    }
+    m_jobReady.notify_one();
+    return job.ticket;
+}
+
+void PathService::collect() {
+    unique_lock<mutex> lock(m_mutex);
+    m_jobsDone.wait(lock, [this] { return m_outstanding == 0; });
+
+    for (size_t i = 0; i < m_finished.size(); ++i) {
+        if (m_cancelled.count(m_finished[i].ticket) == 0) {
+            m_results[m_finished[i].ticket] = m_finished[i].result;
+        }
+    }
+    m_finished.clear();
+    m_cancelled.clear();
+}
+
+void PathService::cancel(unsigned long ticket) {
+    if (m_results.erase(ticket) == 0) {
+        m_cancelled.insert(ticket);
+    }
+}
+
+bool PathService::takeResult(unsigned long ticket, Result& result) {
+    map<unsigned long, Result>::iterator it = m_results.find(ticket);
+    if (it == m_results.end()) return false;
+    result = it->second;
+    m_results.erase(it);
+    return true;
+}
+
+void PathService::workerLoop() {
+    for (;;) {
+        Job job;
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_jobReady.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_stopping && m_queue.empty()) return;
+            job = m_queue.front();
+            m_queue.pop_front();
+        }
+
+        job.result.firstStep = findFirstStep(*job.snapshot, job.result.startX, job.result.startY,
+                                             job.result.endX, job.result.endY, job.result.maxSteps);
+        job.snapshot.reset();
+
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_finished.push_back(job);
+            if (--m_outstanding == 0) m_jobsDone.notify_all();
+        }
+    }
+}
+
+int PathService::findFirstStep(const WalkabilitySnapshot& snapshot, int startX, int startY, int endX, int endY, int maxSteps) {
+    if (!snapshot.isWalkable(endX, endY) || startX < 0 || startX >= snapshot.width ||
+        startY < 0 || startY >= snapshot.height) return -1;
+    if (startX == endX && startY == endY) return -1;
+    if (abs(startX - endX) + abs(startY - endY) > maxSteps) return -1;
+
+    const int w = snapshot.width;
+    const int h = snapshot.height;
+    vector<int> dist(w * h, -1);
+    vector<int> firstStep(w * h, -1);
+    vector<int> q(w * h);
+    int head = 0, tail = 0;
+
+    int start = startY * w + startX;
+    dist[start] = 0;
+    q[tail++] = start;
+    while (head < tail) {
+        int cur = q[head++];
+        int x = cur % w, y = cur / w;
+        int d = dist[cur];
+        if (d >= maxSteps) break;
+        for (int i = 0; i < 4; ++i) {
+            int nx = x + STEP_DX[i];
+            int ny = y + STEP_DY[i];
+            if (!snapshot.isWalkable(nx, ny)) continue;
+            int next = ny * w + nx;
+            if (dist[next] != -1) continue;
+            if (abs(nx - endX) + abs(ny - endY) > maxSteps - d - 1) continue;
+            dist[next] = d + 1;
+            firstStep[next] = (cur == start ? i : firstStep[cur]);
+            if (nx == endX && ny == endY) return firstStep[next];
+            q[tail++] = next;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,74 @@
+#ifndef PATHSERVICE_H_
+#define PATHSERVICE_H_
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+// Read-only copy of the legal protester positions, shared by every job submitted while the
+// world's topology version stays the same.
+struct WalkabilitySnapshot {
+    int width, height;
+    unsigned long version;
+    std::vector<unsigned char> walkable;    // width * height, row-major
+
+    bool isWalkable(int x, int y) const {
+        return x >= 0 && x < width && y >= 0 && y < height && walkable[y * width + x] != 0;
+    }
+};
+
+// Answers path queries on worker threads. Jobs submitted during a tick are waited for at the
+// start of the next one by collect(), so results never depend on thread timing.
+class PathService {
+public:
+    struct Result {
+        unsigned long version;
+        int startX, startY, endX, endY, maxSteps;
+        int firstStep;      // 0-3 for up/down/left/right, -1 if the goal is out of reach
+    };
+
+    explicit PathService(int threadCount = 0);
+    ~PathService();
+
+    unsigned long submit(const std::shared_ptr<const WalkabilitySnapshot>& snapshot,
+                         int startX, int startY, int endX, int endY, int maxSteps);
+    void collect();   // waits for outstanding jobs and publishes their results
+    bool takeResult(unsigned long ticket, Result& result);
+    void cancel(unsigned long ticket);
+
+    int getThreadCount() const { return static_cast<int>(m_workers.size()); }
+
+    // Breadth-first search in up/down/left/right order, matching the world's own first steps.
+    static int findFirstStep(const WalkabilitySnapshot& snapshot, int startX, int startY, int endX, int endY, int maxSteps);
+
+private:
+    struct Job {
+        unsigned long ticket;
+        std::shared_ptr<const WalkabilitySnapshot> snapshot;
+        Result result;
+    };
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_jobReady;
+    std::condition_variable m_jobsDone;
+    std::deque<Job> m_queue;
+    std::vector<Job> m_finished;
+    std::map<unsigned long, Result> m_results;
+    std::set<unsigned long> m_cancelled;
+    int m_outstanding;
+    unsigned long m_nextTicket;
+    bool m_stopping;
+
+    void workerLoop();
+
+    PathService(const PathService&);
+    PathService& operator=(const PathService&);
+};
+
+#endif // PATHSERVICE_H_
@@ -0,0 +1,50 @@
+#include "Proximity.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PROXIMITY_USE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PROXIMITY_USE_SSE2
+#endif
+using namespace std;
+
+// The vector paths square the offsets in single precision. Coordinates on the board are far below
+// 2^11, so every product and sum is an exact integer in a float and the comparison matches the
+// scalar test bit for bit.
+
+void findWithinRadius(const int* xs, const int* ys, int count, int centerX, int centerY, int radius,
+                      unsigned long long* hits) {
+    for (int w = 0; w < (count + 63) / 64; ++w) {
+        hits[w] = 0;
+    }
+
+    int i = 0;
+#if defined(PROXIMITY_USE_AVX2)
+    const __m256 cx = _mm256_set1_ps(static_cast<float>(centerX));
+    const __m256 cy = _mm256_set1_ps(static_cast<float>(centerY));
+    const __m256 r2 = _mm256_set1_ps(static_cast<float>(radius * radius));
+    for (; i + 8 <= count; i += 8) {
+        __m256 dx = _mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(xs + i))), cx);
+        __m256 dy = _mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ys + i))), cy);
+        __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        unsigned long long mask = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_cmp_ps(d2, r2, _CMP_LE_OQ)));
+        hits[i / 64] |= mask << (i % 64);
+    }
+#elif defined(PROXIMITY_USE_SSE2)
+    const __m128 cx = _mm_set1_ps(static_cast<float>(centerX));
+    const __m128 cy = _mm_set1_ps(static_cast<float>(centerY));
+    const __m128 r2 = _mm_set1_ps(static_cast<float>(radius * radius));
+    for (; i + 4 <= count; i += 4) {
+        __m128 dx = _mm_sub_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(xs + i))), cx);
+        __m128 dy = _mm_sub_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ys + i))), cy);
+        __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        unsigned long long mask = static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(d2, r2)));
+        hits[i / 64] |= mask << (i % 64);
+    }
+#endif
+    for (; i < count; ++i) {
+        if (squaredDistance(xs[i], ys[i], centerX, centerY) <= radius * radius) {
+            hits[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef PROXIMITY_H_
+#define PROXIMITY_H_
+
+// Integer proximity tests. The game measures distance between the centres of 4x4 sprites, and
+// since every sprite is offset by the same half size the centre offset is just the difference of
+// the bottom-left corners. Comparing squared integer offsets gives the same answers as the old
+// sqrt-on-doubles test (the radii are whole numbers) without any floating point.
+
+const int MAX_STENCIL_RADIUS = 12;
+
+inline int squaredDistance(int x1, int y1, int x2, int y2)
+{
+    int dx = x1 - x2;
+    int dy = y1 - y2;
+    return dx * dx + dy * dy;
+}
+
+// Circular stencil for one radius: for each row offset |dy| <= radius, the largest |dx| inside the circle.
+class RadiusStencil {
+public:
+    constexpr RadiusStencil(int radius)
+        : m_radius(radius), m_halfWidth()
+    {
+        for (int dy = 0; dy <= radius; dy++)
+        {
+            int dx = 0;
+            while ((dx + 1) * (dx + 1) + dy * dy <= radius * radius)
+                dx++;
+            m_halfWidth[dy] = dx;
+        }
+    }
+
+    constexpr int radius() const
+    {
+        return m_radius;
+    }
+
+    constexpr int halfWidth(int dy) const
+    {
+        return m_halfWidth[dy < 0 ? -dy : dy];
+    }
+
+    constexpr bool contains(int dx, int dy) const
+    {
+        return (dy < 0 ? -dy : dy) <= m_radius && (dx < 0 ? -dx : dx) <= halfWidth(dy);
+    }
+
+private:
+    int m_radius;
+    int m_halfWidth[MAX_STENCIL_RADIUS + 1];
+};
+
+constexpr RadiusStencil PROXIMITY_STENCILS[MAX_STENCIL_RADIUS + 1] = {
+    RadiusStencil(0), RadiusStencil(1), RadiusStencil(2), RadiusStencil(3), RadiusStencil(4),
+    RadiusStencil(5), RadiusStencil(6), RadiusStencil(7), RadiusStencil(8), RadiusStencil(9),
+    RadiusStencil(10), RadiusStencil(11), RadiusStencil(12)
+};
+
+static_assert(PROXIMITY_STENCILS[3].halfWidth(2) == 2, "radius 3 stencil");
+static_assert(PROXIMITY_STENCILS[6].halfWidth(6) == 0, "radius 6 stencil");
+static_assert(PROXIMITY_STENCILS[12].halfWidth(5) == 10, "radius 12 stencil");
+
+// Same as sqrt(dx*dx + dy*dy) <= radius for the sprite corners (x1, y1) and (x2, y2).
+inline bool isWithinRadius(int x1, int y1, int x2, int y2, int radius)
+{
+    if (radius >= 0 && radius <= MAX_STENCIL_RADIUS)
+        return PROXIMITY_STENCILS[radius].contains(x1 - x2, y1 - y2);
+    return squaredDistance(x1, y1, x2, y2) <= radius * radius;
+}
+
+// Batched form of isWithinRadius over packed coordinates: bit (i % 64) of hits[i / 64] is set when
+// (xs[i], ys[i]) is within radius of (centerX, centerY). hits must hold (count + 63) / 64 words.
+// Uses AVX2 or SSE2 when the compiler targets them and a scalar loop otherwise.
+void findWithinRadius(const int* xs, const int* ys, int count, int centerX, int centerY, int radius,
+                      unsigned long long* hits);
+
+#endif // PROXIMITY_H_
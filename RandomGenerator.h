@@ -0,0 +1,61 @@
+#ifndef RANDOMGENERATOR_H_
+#define RANDOMGENERATOR_H_
+
+// xoshiro256** with splitmix64 seeding. Each world owns one, so a run is reproducible from its
+// seed and several worlds can share a process without touching rand()'s hidden global state.
+// The output sequence is fixed by the algorithm, not by the standard library, so a seed plays
+// the same on every platform.
+class RandomGenerator {
+public:
+    struct State {
+        unsigned long long s[4];
+    };
+
+    explicit RandomGenerator(unsigned long long seed = 0) { setSeed(seed); }
+
+    void setSeed(unsigned long long seed) {
+        for (int i = 0; i < 4; ++i) {
+            seed += 0x9E3779B97F4A7C15ULL;
+            unsigned long long z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            m_state.s[i] = z ^ (z >> 31);
+        }
+    }
+
+    unsigned long long next() {
+        unsigned long long* s = m_state.s;
+        unsigned long long result = rotateLeft(s[1] * 5, 7) * 9;
+        unsigned long long t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotateLeft(s[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, bound); bound must be positive.
+    int nextInt(int bound) {
+        unsigned long long range = static_cast<unsigned long long>(bound);
+        unsigned long long limit = ~0ULL - (~0ULL % range);
+        unsigned long long value;
+        do {
+            value = next();
+        } while (value >= limit);
+        return static_cast<int>(value % range);
+    }
+
+    const State& getState() const { return m_state; }
+    void setState(const State& state) { m_state = state; }
+
+private:
+    State m_state;
+
+    static unsigned long long rotateLeft(unsigned long long x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+};
+
+#endif // RANDOMGENERATOR_H_
@@ -0,0 +1,223 @@
+#include "Replay.h"
+#include "BinaryIO.h"
+#include "StudentWorld.h"
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <sstream>
+using namespace std;
+
+namespace {
+    const char REPLAY_MAGIC[] = { 'T', 'M', 'R', 'P' };
+}
+
+string Replay::encode() const {
+    ByteWriter out;
+    out.writeBytes(string(REPLAY_MAGIC, sizeof(REPLAY_MAGIC)));
+    out.writeVarint(FORMAT_VERSION);
+    out.writeVarint(seed);
+    out.writeVarint(endTick);
+    out.writeVarint(events.size());
+
+    unsigned long previousTick = 0;
+    for (const ReplayEvent& event : events) {
+        out.writeVarint(event.tick - previousTick);
+        out.writeVarint(static_cast<unsigned int>(event.key));
+        previousTick = event.tick;
+    }
+
+    out.writeVarint(keyframes.size());
+    previousTick = 0;
+    for (const ReplayKeyframe& keyframe : keyframes) {
+        out.writeVarint(keyframe.tick - previousTick);
+        out.writeVarint(keyframe.state.size());
+        out.writeBytes(keyframe.state);
+        previousTick = keyframe.tick;
+    }
+
+    out.writeVarint(checksums.size());
+    previousTick = 0;
+    for (const ReplayChecksum& checksum : checksums) {
+        out.writeVarint(checksum.tick - previousTick);
+        out.writeFixed64(checksum.hash);
+        previousTick = checksum.tick;
+    }
+    return out.bytes();
+}
+
+bool Replay::decode(const string& bytes) {
+    ByteReader in(bytes);
+    string magic;
+    unsigned long long version = 0, seedValue = 0, endTickValue = 0, count = 0;
+    if (!in.readBytes(sizeof(REPLAY_MAGIC), magic) || magic != string(REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) ||
+        !in.readVarint(version) || version < 1 || version > FORMAT_VERSION ||
+        !in.readVarint(seedValue) || !in.readVarint(endTickValue) || !in.readVarint(count) ||
+        count > bytes.size()) {
+        return false;
+    }
+
+    vector<ReplayEvent> decoded;
+    decoded.reserve(static_cast<size_t>(count));
+    unsigned long tick = 0;
+    for (unsigned long long i = 0; i < count; ++i) {
+        unsigned long long delta, key;
+        if (!in.readVarint(delta) || !in.readVarint(key)) {
+            return false;
+        }
+        tick += static_cast<unsigned long>(delta);
+        ReplayEvent event = { tick, static_cast<int>(key) };
+        decoded.push_back(event);
+    }
+
+    vector<ReplayKeyframe> decodedKeyframes;
+    unsigned long long keyframeCount = 0;
+    if (version >= 2 && (!in.readVarint(keyframeCount) || keyframeCount > bytes.size())) {
+        return false;
+    }
+    tick = 0;
+    for (unsigned long long i = 0; i < keyframeCount; ++i) {
+        unsigned long long delta, length;
+        ReplayKeyframe keyframe;
+        if (!in.readVarint(delta) || !in.readVarint(length) || length > bytes.size() ||
+            !in.readBytes(static_cast<size_t>(length), keyframe.state)) {
+            return false;
+        }
+        tick += static_cast<unsigned long>(delta);
+        keyframe.tick = tick;
+        decodedKeyframes.push_back(keyframe);
+    }
+
+    vector<ReplayChecksum> decodedChecksums;
+    unsigned long long checksumCount = 0;
+    if (version >= 3 && (!in.readVarint(checksumCount) || checksumCount > bytes.size())) {
+        return false;
+    }
+    tick = 0;
+    for (unsigned long long i = 0; i < checksumCount; ++i) {
+        unsigned long long delta;
+        ReplayChecksum checksum;
+        if (!in.readVarint(delta) || !in.readFixed64(checksum.hash)) {
+            return false;
+        }
+        tick += static_cast<unsigned long>(delta);
+        checksum.tick = tick;
+        decodedChecksums.push_back(checksum);
+    }
+    if (!in.atEnd()) {
+        return false;
+    }
+    if (version < FORMAT_VERSION) {
+        decodedKeyframes.clear();
+        decodedChecksums.clear();
+    }
+
+    seed = seedValue;
+    endTick = static_cast<unsigned long>(endTickValue);
+    events.swap(decoded);
+    keyframes.swap(decodedKeyframes);
+    checksums.swap(decodedChecksums);
+    return true;
+}
+
+bool Replay::save(const string& path) const {
+    ofstream file(path.c_str(), ios::binary);
+    string bytes = encode();
+    file.write(bytes.data(), bytes.size());
+    return static_cast<bool>(file);
+}
+
+bool Replay::load(const string& path) {
+    ifstream file(path.c_str(), ios::binary);
+    if (!file) {
+        return false;
+    }
+    ostringstream contents;
+    contents << file.rdbuf();
+    return decode(contents.str());
+}
+
+ReplayRecorder::ReplayRecorder(unsigned long long seed, unsigned long keyframeInterval)
+    : m_keyframeInterval(keyframeInterval), m_checksumInterval(0) {
+    m_replay.seed = seed;
+}
+
+void ReplayRecorder::recordKey(unsigned long tick, int key) {
+    ReplayEvent event = { tick, key };
+    m_replay.events.push_back(event);
+}
+
+void ReplayRecorder::beforeTick(StudentWorld& world) {
+    unsigned long tick = world.getTick();
+    if (m_checksumInterval != 0 && tick % m_checksumInterval == 0 &&
+        (m_replay.checksums.empty() || m_replay.checksums.back().tick != tick)) {
+        assert(world.actorHashIsConsistent());
+        ReplayChecksum checksum = { tick, world.getStateHash() };
+        m_replay.checksums.push_back(checksum);
+    }
+    if (m_keyframeInterval == 0 || tick % m_keyframeInterval != 0 ||
+        (!m_replay.keyframes.empty() && m_replay.keyframes.back().tick == tick)) {
+        return;
+    }
+    ByteWriter out;
+    world.writeSnapshot(out);
+    ReplayKeyframe keyframe = { tick, out.bytes() };
+    m_replay.keyframes.push_back(keyframe);
+}
+
+void ReplayRecorder::finish(unsigned long endTick) {
+    m_replay.endTick = endTick;
+}
+
+ReplayPlayer::ReplayPlayer(const Replay& replay)
+    : m_replay(replay), m_next(0) {
+}
+
+bool ReplayPlayer::keyForTick(unsigned long tick, int& key) {
+    while (m_next < m_replay.events.size() && m_replay.events[m_next].tick < tick) {
+        ++m_next;
+    }
+    if (m_next < m_replay.events.size() && m_replay.events[m_next].tick == tick) {
+        key = m_replay.events[m_next++].key;
+        return true;
+    }
+    return false;
+}
+
+ReplayVerifier::ReplayVerifier(const Replay& replay)
+    : m_replay(replay), m_next(0), m_checked(0), m_diverged(false), m_firstDivergentTick(0) {
+}
+
+void ReplayVerifier::beforeTick(StudentWorld& world) {
+    unsigned long tick = world.getTick();
+    while (m_next < m_replay.checksums.size() && m_replay.checksums[m_next].tick < tick) {
+        ++m_next;
+    }
+    if (m_next == m_replay.checksums.size() || m_replay.checksums[m_next].tick != tick) {
+        return;
+    }
+    ++m_checked;
+    assert(world.actorHashIsConsistent());
+    if (!m_diverged && world.getStateHash() != m_replay.checksums[m_next].hash) {
+        m_diverged = true;
+        m_firstDivergentTick = tick;
+    }
+    ++m_next;
+}
+
+bool seekReplay(const Replay& replay, StudentWorld& world, unsigned long tick) {
+    auto after = upper_bound(replay.keyframes.begin(), replay.keyframes.end(), tick,
+                             [](unsigned long t, const ReplayKeyframe& keyframe) { return t < keyframe.tick; });
+    if (after == replay.keyframes.begin()) {
+        return false;
+    }
+    const ReplayKeyframe& keyframe = *(after - 1);
+    ByteReader in(keyframe.state);
+    if (!world.readSnapshot(in)) {
+        return false;
+    }
+    if (tick > keyframe.tick) {
+        ReplayPlayer player(replay);
+        HeadlessDriver(&world, &player).resume(tick - keyframe.tick);
+    }
+    return true;
+}
@@ -0,0 +1,116 @@
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include "GameWorld.h"
+#include "HeadlessDriver.h"
+#include <string>
+#include <vector>
+
+struct ReplayEvent {
+    unsigned long tick;
+    int key;
+};
+
+// The whole world as it stood just before the given tick (StudentWorld::writeSnapshot).
+struct ReplayKeyframe {
+    unsigned long tick;
+    std::string state;
+};
+
+// The world's state hash (StudentWorld::getStateHash) just before the given tick.
+struct ReplayChecksum {
+    unsigned long tick;
+    unsigned long long hash;
+};
+
+// A recorded game: the world's random seed plus every key the world read, stamped with the tick
+// it was read on. Playing the keys back into a fresh world seeded the same way reproduces the game.
+//
+// File layout: the magic "TMRP", then varints for the format version, the seed, the tick count
+// and the event count, then one (ticks since the previous event, key) varint pair per event.
+// Most events cost two or three bytes. Version 2 appends the keyframe count and, per keyframe,
+// varints for the ticks since the previous one and the state's length, then the state bytes.
+// Version 3 appends the checksum count and, per checksum, a varint for the ticks since the
+// previous one and the 8-byte hash. Versions 4 and 6 change the snapshot layout inside
+// keyframes; version 5 changes what the checksums cover.
+// Older versions still load, but only their keys: keyframes and checksums hold the snapshot
+// layout and state hash of the version that wrote them, and are dropped.
+class Replay {
+public:
+    static const unsigned int FORMAT_VERSION = 6;
+
+    Replay() : seed(0), endTick(0) {}
+
+    unsigned long long seed;
+    unsigned long endTick;              // number of ticks the recording covers
+    std::vector<ReplayEvent> events;    // in tick order
+    std::vector<ReplayKeyframe> keyframes;  // in tick order
+    std::vector<ReplayChecksum> checksums;  // in tick order
+
+    std::string encode() const;
+    bool decode(const std::string& bytes);
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+};
+
+// Install with GameWorld::setInputRecorder before the world's first tick. To also take keyframes,
+// install it as the HeadlessDriver's tick observer; a snapshot is saved every keyframeInterval
+// ticks (0 for none). Shorter intervals make seeking faster and the file bigger. Checksums work
+// the same way and are off unless setChecksumInterval() turns them on.
+class ReplayRecorder : public InputRecorder, public TickObserver {
+public:
+    static const unsigned long DEFAULT_KEYFRAME_INTERVAL = 500;
+
+    explicit ReplayRecorder(unsigned long long seed, unsigned long keyframeInterval = DEFAULT_KEYFRAME_INTERVAL);
+
+    virtual void recordKey(unsigned long tick, int key) override;
+    virtual void beforeTick(StudentWorld& world) override;
+    void finish(unsigned long endTick);
+    void setChecksumInterval(unsigned long ticks) { m_checksumInterval = ticks; }
+
+    const Replay& getReplay() const { return m_replay; }
+
+private:
+    Replay m_replay;
+    unsigned long m_keyframeInterval;
+    unsigned long m_checksumInterval;
+};
+
+// Feeds a replay's keys to a HeadlessDriver, each on the tick it was recorded.
+class ReplayPlayer : public KeyScript {
+public:
+    explicit ReplayPlayer(const Replay& replay);
+
+    virtual bool keyForTick(unsigned long tick, int& key) override;
+
+private:
+    const Replay& m_replay;
+    std::size_t m_next;
+};
+
+// Checks the world against a replay's checksums as it plays back and remembers the first tick
+// whose hash differs. Install as the HeadlessDriver's tick observer alongside a ReplayPlayer.
+class ReplayVerifier : public TickObserver {
+public:
+    explicit ReplayVerifier(const Replay& replay);
+
+    virtual void beforeTick(StudentWorld& world) override;
+
+    unsigned long getChecked() const { return m_checked; }
+    bool hasDiverged() const { return m_diverged; }
+    unsigned long getFirstDivergentTick() const { return m_firstDivergentTick; }
+
+private:
+    const Replay& m_replay;
+    std::size_t m_next;
+    unsigned long m_checked;
+    bool m_diverged;
+    unsigned long m_firstDivergentTick;
+};
+
+// Puts the world where the recording stood just before `tick`: restores the last keyframe at or
+// before it and plays the recorded keys from there. Returns false if there is no such keyframe.
+bool seekReplay(const Replay& replay, StudentWorld& world, unsigned long tick);
+
+#endif // REPLAY_H_
@@ -0,0 +1,153 @@
+#include "RewindBuffer.h"
+#include <algorithm>
+using namespace std;
+
+namespace {
+
+void putVarint(vector<unsigned char>& out, size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<unsigned char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+size_t getVarint(const unsigned char*& in) {
+    size_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        unsigned char byte = *in++;
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return value;
+    }
+}
+
+}
+
+RewindBuffer::RewindBuffer(size_t budgetBytes)
+    : m_ring(budgetBytes), m_head(0), m_bytesUsed(0), m_hasNewest(false) {
+}
+
+void RewindBuffer::setBudget(size_t budgetBytes) {
+    vector<unsigned char>(budgetBytes).swap(m_ring);
+    clear();
+}
+
+void RewindBuffer::clear() {
+    m_deltas.clear();
+    m_head = 0;
+    m_bytesUsed = 0;
+    m_newest.clear();
+    m_hasNewest = false;
+}
+
+void RewindBuffer::push(const string& snapshot) {
+    if (!isEnabled()) {
+        return;
+    }
+    if (m_hasNewest) {
+        encodeDelta(m_newest, snapshot);
+        store(m_scratch);
+    }
+    m_newest.assign(snapshot);
+    m_hasNewest = true;
+}
+
+bool RewindBuffer::pop(string& snapshot) {
+    if (!m_hasNewest) {
+        return false;
+    }
+    snapshot = m_newest;
+    if (m_deltas.empty()) {
+        m_hasNewest = false;
+        return true;
+    }
+    const Delta& last = m_deltas.back();
+    applyDelta(last, m_newest);
+    m_head = last.offset;
+    m_bytesUsed -= last.length;
+    m_deltas.pop_back();
+    return true;
+}
+
+// Layout: the older snapshot's length, then (zero run, literal count, literal XOR bytes) pairs
+// over the longer of the two snapshots, the shorter one read as if padded with zeros.
+void RewindBuffer::encodeDelta(const string& older, const string& newer) {
+    m_scratch.clear();
+    putVarint(m_scratch, older.size());
+
+    const string* a = &older;
+    const string* b = &newer;
+    if (older.size() != newer.size()) {
+        m_padded = older.size() < newer.size() ? older : newer;
+        m_padded.resize(max(older.size(), newer.size()), 0);
+        (older.size() < newer.size() ? a : b) = &m_padded;
+    }
+    const char* x = a->data();
+    const char* y = b->data();
+    size_t length = a->size();
+    size_t i = 0;
+    while (i < length) {
+        size_t runStart = i;
+        while (i < length && x[i] == y[i]) {
+            ++i;
+        }
+        if (i == length) {
+            break;
+        }
+        size_t literalStart = i;
+        while (i < length && x[i] != y[i]) {
+            ++i;
+        }
+        putVarint(m_scratch, literalStart - runStart);
+        putVarint(m_scratch, i - literalStart);
+        for (size_t j = literalStart; j < i; ++j) {
+            m_scratch.push_back(static_cast<unsigned char>(x[j] ^ y[j]));
+        }
+    }
+}
+
+// Deltas are written contiguously; one that would run past the end of the ring starts over at
+// the beginning. Whatever it lands on is the oldest history and is dropped.
+void RewindBuffer::store(const vector<unsigned char>& delta) {
+    if (delta.size() > m_ring.size()) {
+        m_deltas.clear();
+        m_head = 0;
+        m_bytesUsed = 0;
+        return;
+    }
+    size_t start = m_head;
+    if (start + delta.size() > m_ring.size()) {
+        while (!m_deltas.empty() && m_deltas.front().offset >= m_head) {
+            m_bytesUsed -= m_deltas.front().length;
+            m_deltas.pop_front();
+        }
+        start = 0;
+    }
+    while (!m_deltas.empty() && m_deltas.front().offset < start + delta.size() &&
+           m_deltas.front().offset + m_deltas.front().length > start) {
+        m_bytesUsed -= m_deltas.front().length;
+        m_deltas.pop_front();
+    }
+    copy(delta.begin(), delta.end(), m_ring.begin() + start);
+    Delta stored = { start, delta.size() };
+    m_deltas.push_back(stored);
+    m_head = start + delta.size();
+    m_bytesUsed += delta.size();
+}
+
+void RewindBuffer::applyDelta(const Delta& delta, string& state) const {
+    const unsigned char* in = &m_ring[delta.offset];
+    const unsigned char* end = in + delta.length;
+    size_t olderLength = getVarint(in);
+    state.resize(max(state.size(), olderLength), 0);
+    size_t pos = 0;
+    while (in < end) {
+        pos += getVarint(in);
+        size_t count = getVarint(in);
+        for (size_t j = 0; j < count; ++j) {
+            state[pos + j] = static_cast<char>(state[pos + j] ^ *in++);
+        }
+        pos += count;
+    }
+    state.resize(olderLength);
+}
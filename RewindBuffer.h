@@ -0,0 +1,54 @@
+#ifndef REWINDBUFFER_H_
+#define REWINDBUFFER_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstddef>
+
+// The most recent world snapshots, newest first out, under a fixed byte budget. Only the newest
+// snapshot is held whole. Each older one is kept as its XOR against the snapshot after it, with
+// the runs of zero bytes squeezed out, so a tick that changed little costs a few dozen bytes.
+// The deltas live in a ring allocated once at the budget's size; when it fills up, the oldest
+// states are overwritten first.
+class RewindBuffer {
+public:
+    static const std::size_t DEFAULT_BUDGET_BYTES = 1 << 20;
+
+    // 0 turns recording off.
+    explicit RewindBuffer(std::size_t budgetBytes = 0);
+
+    // Drops everything held and reallocates the ring.
+    void setBudget(std::size_t budgetBytes);
+    std::size_t getBudget() const { return m_ring.size(); }
+    bool isEnabled() const { return !m_ring.empty(); }
+
+    void push(const std::string& snapshot);
+    // Hands back the newest snapshot and forgets it; false if nothing is left.
+    bool pop(std::string& snapshot);
+    void clear();
+
+    std::size_t getStateCount() const { return m_hasNewest ? m_deltas.size() + 1 : 0; }
+    // Ring bytes taken by the deltas, not counting the newest snapshot.
+    std::size_t getBytesUsed() const { return m_bytesUsed; }
+
+private:
+    struct Delta {
+        std::size_t offset, length;
+    };
+
+    std::vector<unsigned char> m_ring;
+    std::deque<Delta> m_deltas;    // oldest first
+    std::size_t m_head;            // where the next delta is written
+    std::size_t m_bytesUsed;
+    std::string m_newest;
+    bool m_hasNewest;
+    std::vector<unsigned char> m_scratch;
+    std::string m_padded;
+
+    void encodeDelta(const std::string& older, const std::string& newer);
+    void store(const std::vector<unsigned char>& delta);
+    void applyDelta(const Delta& delta, std::string& state) const;
+};
+
+#endif // REWINDBUFFER_H_
@@ -0,0 +1,53 @@
+#include "SaveGame.h"
+#include "StudentWorld.h"
+#include "BinaryIO.h"
+#include <fstream>
+#include <sstream>
+using namespace std;
+
+namespace {
+    const char SAVE_GAME_MAGIC[] = { 'T', 'M', 'S', 'V' };
+}
+
+string encodeSaveGame(const StudentWorld& world) {
+    ByteWriter out;
+    out.writeBytes(string(SAVE_GAME_MAGIC, sizeof(SAVE_GAME_MAGIC)));
+    out.writeVarint(SAVE_GAME_FORMAT_VERSION);
+    world.writeSnapshot(out);
+    return out.bytes();
+}
+
+bool decodeSaveGame(const string& bytes, StudentWorld& world) {
+    ByteReader in(bytes);
+    string magic;
+    unsigned long long version;
+    if (!in.readBytes(sizeof(SAVE_GAME_MAGIC), magic) || magic != string(SAVE_GAME_MAGIC, sizeof(SAVE_GAME_MAGIC)) ||
+        !in.readVarint(version) || version != SAVE_GAME_FORMAT_VERSION) {
+        return false;
+    }
+    if (!world.readSnapshot(in)) {
+        return false;
+    }
+    if (!in.atEnd()) {
+        world.cleanUp();
+        return false;
+    }
+    return true;
+}
+
+bool saveGame(const StudentWorld& world, const string& path) {
+    ofstream file(path.c_str(), ios::binary);
+    string bytes = encodeSaveGame(world);
+    file.write(bytes.data(), bytes.size());
+    return static_cast<bool>(file);
+}
+
+bool loadGame(const string& path, StudentWorld& world) {
+    ifstream file(path.c_str(), ios::binary);
+    if (!file) {
+        return false;
+    }
+    ostringstream contents;
+    contents << file.rdbuf();
+    return decodeSaveGame(contents.str(), world);
+}
@@ -0,0 +1,24 @@
+#ifndef SAVEGAME_H_
+#define SAVEGAME_H_
+
+#include <string>
+
+class StudentWorld;
+
+// A game in progress on disk. File layout: the magic "TMSV", a varint format version, then the
+// world snapshot (StudentWorld::writeSnapshot): varint counters, the earth field as one 64-bit
+// word per column with a bit per cell, then TunnelMan and each actor as a kind byte, a position
+// and the fields its class saves, then the path cache entries made since the last dig or boulder
+// move and the generator state. A level in progress comes to about a kilobyte. Version 2 saves a
+// path request per query kind for each protester, version 3 only the path cache entries that
+// can still match; older files are refused.
+const unsigned int SAVE_GAME_FORMAT_VERSION = 3;
+
+std::string encodeSaveGame(const StudentWorld& world);
+// Leaves the world alone if the header is wrong; a damaged body leaves its level cleaned up.
+bool decodeSaveGame(const std::string& bytes, StudentWorld& world);
+
+bool saveGame(const StudentWorld& world, const std::string& path);
+bool loadGame(const std::string& path, StudentWorld& world);
+
+#endif // SAVEGAME_H_
@@ -0,0 +1,21 @@
+#ifndef STATEHASH_H_
+#define STATEHASH_H_
+
+// Building blocks for the world state hash. zobristKey gives every earth cell a fixed
+// pseudo-random key, so the earth part of the hash is the XOR of the keys of the cells that are
+// present and can be updated one dig at a time. The keys are computed rather than tabled, so
+// they take no memory and come out the same on every platform.
+
+inline unsigned long long finalizeHash(unsigned long long z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+inline unsigned long long zobristKey(int x, int y)
+{
+    return finalizeHash((static_cast<unsigned long long>(x) << 32 | static_cast<unsigned int>(y)) + 0x2545F4914F6CDD1DULL);
+}
+
+#endif // STATEHASH_H_
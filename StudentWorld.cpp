@@ -1,6 +1,10 @@
 #include "StudentWorld.h"
 #include "Actor.h"
 #include "GameConstants.h"
+#include "Proximity.h"
+#include "LevelGenerator.h"
+#include "BinaryIO.h"
+#include "StateHash.h"
 #include <string>
 #include <vector>
 #include <list>
@@ -9,118 +13,388 @@
 #include <sstream>
 #include <cmath>
 #include <queue>
+#include <chrono>
 using namespace std;
 
 StudentWorld::StudentWorld(std::string assetPath)
-    : GameWorld(assetPath), m_tunnelman(nullptr), m_barrelsRemaining(0),
+    : GameWorld(assetPath), m_earthHash(0), m_actorHash(0), m_tunnelman(nullptr), m_barrelsRemaining(0),
       m_ticksSinceLastProtesterAdded(0),
       m_targetNumberOfProtesters(0),
       m_currentNumberOfProtestersOnField(0),
-      m_lastAnnoyanceSource(nullptr) {
+      m_lastAnnoyanceSource(nullptr),
+      m_pathQueryCount(0),
+      m_lastPathNodesExpanded(0),
+      m_totalPathNodesExpanded(0),
+      m_lastLevelGenerationMicros(0),
+      m_inPlaceReset(true),
+      m_earthSprites(true),
+      m_lastCleanUpMicros(0),
+      m_lastResetMicros(0),
+      m_topologyVersion(0),
+      m_walkableCells((OIL_FIELD_WIDTH - SPRITE_WIDTH + 1) * (GAME_BOARD_HEIGHT - SPRITE_HEIGHT + 1), -1) {
     for (int i = 0; i < OIL_FIELD_WIDTH; ++i) {
         for (int j = 0; j < EARTH_FIELD_HEIGHT; ++j) {
             m_earth[i][j] = nullptr;
+            m_earthStorage[i][j] = nullptr;
         }
     }
+    for (int i = 0; i < BLOCKER_MASK_LINES; ++i) {
+        m_earthRows[i] = m_earthColumns[i] = 0;
+        m_boulderRows[i] = m_boulderColumns[i] = 0;
+    }
 }
 
 StudentWorld::~StudentWorld() {
     cleanUp();
+    if (m_earthSprites) {
+        releaseEarthStorage();
+    }
+    delete m_tunnelman;
 }
 
 GameWorld* createStudentWorld(string assetDir)
 {
-    return new StudentWorld(assetDir);
+    StudentWorld* world = new StudentWorld(assetDir);
+    world->setRewindBudget(RewindBuffer::DEFAULT_BUDGET_BYTES);
+    return world;
 }
 
 int StudentWorld::init() {
+    auto start = chrono::steady_clock::now();
     m_barrelsRemaining = 0;
     m_ticksSinceLastProtesterAdded = 200;
+    m_targetNumberOfProtesters = 0;
     m_currentNumberOfProtestersOnField = 0;
     m_lastAnnoyanceSource = nullptr;
 
-    m_tunnelman = new TunnelMan(this);
+    if (m_tunnelman) {
+        m_tunnelman->reset();
+    } else {
+        m_tunnelman = new TunnelMan(this);
+        m_tunnelman->setHashTracked(true);
+    }
+
+    LevelLayout layout = takeLevelLayout();
+    m_lastLevelGenerationMicros = layout.generationMicros;
 
     for (int x = 0; x < OIL_FIELD_WIDTH; ++x) {
         for (int y = 0; y < EARTH_FIELD_HEIGHT; ++y) {
-            if (x >= TUNNEL_SHAFT_X_START && x <= TUNNEL_SHAFT_X_END && y >= TUNNEL_SHAFT_Y_BOTTOM_NO_EARTH) {
-                m_earth[x][y] = nullptr;
-            } else {
-                m_earth[x][y] = new Earth(this, x, y);
+            if ((layout.earthColumns[x] >> y) & 1) {
+                placeEarth(x, y);
             }
         }
     }
 
-    populateOilFieldWithObjects();
+    populateOilFieldWithObjects(layout);
+    rebuildBoulderMasks();
+    topologyChangedAt(0, 0, OIL_FIELD_WIDTH - 1, GAME_BOARD_HEIGHT - 1);
 
+    m_lastResetMicros = m_lastCleanUpMicros +
+        chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+    m_lastCleanUpMicros = 0;
     return GWSTATUS_CONTINUE_GAME;
 }
 
-void StudentWorld::populateOilFieldWithObjects() {
-    int currentLevel = getLevel();
+void StudentWorld::prepareNextLevel() {
+    if (m_nextLayout.valid()) {
+        return;
+    }
+    int level = getLevel();
+    unsigned long long seed = m_random.next();
+    m_nextLayout = std::async(std::launch::async, [level, seed]() {
+        return generateLevelLayout(level, seed);
+    });
+}
 
+StudentWorld::StudentWorld(const StudentWorld& other)
+    : GameWorld(other.assetDirectory()), m_earthHash(other.m_earthHash), m_actorHash(0), m_tunnelman(nullptr),
+      m_barrelsRemaining(other.m_barrelsRemaining),
+      m_ticksSinceLastProtesterAdded(other.m_ticksSinceLastProtesterAdded),
+      m_targetNumberOfProtesters(other.m_targetNumberOfProtesters),
+      m_currentNumberOfProtestersOnField(other.m_currentNumberOfProtestersOnField),
+      m_lastAnnoyanceSource(nullptr),
+      m_pathQueryCount(0),
+      m_lastPathNodesExpanded(0),
+      m_totalPathNodesExpanded(0),
+      m_lastLevelGenerationMicros(0),
+      m_inPlaceReset(other.m_inPlaceReset),
+      m_earthSprites(false),
+      m_lastCleanUpMicros(0),
+      m_lastResetMicros(0),
+      m_random(other.m_random),
+      m_topologyVersion(other.m_topologyVersion),
+      m_pathCache(other.m_pathCache, other.m_topologyVersion),
+      m_pathScheduler(other.m_pathScheduler),
+      m_walkableCells(other.m_walkableCells),
+      m_walkabilitySnapshot(other.m_walkabilitySnapshot) {
+    for (int i = 0; i < OIL_FIELD_WIDTH; ++i) {
+        for (int j = 0; j < EARTH_FIELD_HEIGHT; ++j) {
+            m_earth[i][j] = nullptr;
+            m_earthStorage[i][j] = nullptr;
+        }
+    }
+    for (int i = 0; i < BLOCKER_MASK_LINES; ++i) {
+        m_earthRows[i] = other.m_earthRows[i];
+        m_earthColumns[i] = other.m_earthColumns[i];
+        m_boulderRows[i] = other.m_boulderRows[i];
+        m_boulderColumns[i] = other.m_boulderColumns[i];
+    }
+    restoreCounters(other.getLives(), other.getScore(), other.getLevel(), other.getTick());
 
-    int numBoulders = std::min(currentLevel / 2 + 2, 9);
-    for (int i = 0; i < numBoulders; ++i) {
-        int x, y;
-        bool placed;
-        do {
-            placed = true;
-            x = rand() % (OIL_FIELD_WIDTH - SPRITE_WIDTH + 1);
-            y = (rand() % (56 - 20 + 1)) + 20;
+    if (other.m_tunnelman) {
+        m_tunnelman = static_cast<TunnelMan*>(other.m_tunnelman->clone(this));
+        m_tunnelman->setHashTracked(true);
+    }
+    for (const Actor* actor : other.m_actors) {
+        addActor(actor->clone(this));
+    }
+}
 
-            if (x + SPRITE_WIDTH -1 >= TUNNEL_SHAFT_X_START && x <= TUNNEL_SHAFT_X_END) {
-                 placed = false; continue;
-            }
-            
-            if (isAnyObjectNearby(x, y, 6.0, false)) {
-                placed = false; continue;
-            }
+StudentWorld* StudentWorld::clone() const {
+    return new StudentWorld(*this);
+}
 
-        } while (!placed);
-        addActor(new Boulder(this, x, y));
+bool StudentWorld::rewindOneTick() {
+    string snapshot;
+    if (!m_rewind.pop(snapshot)) {
+        return false;
     }
+    ByteReader in(snapshot);
+    if (!readSnapshot(in)) {
+        return false;
+    }
+    updateGameStatText();
+    return true;
+}
 
-    int numGold = std::max(5 - currentLevel / 2, 2);
-    for (int i = 0; i < numGold; ++i) {
-        int x, y;
-        bool placed;
-        do {
-            placed = true;
-            x = rand() % (OIL_FIELD_WIDTH - SPRITE_WIDTH + 1);
-            y = rand() % (EARTH_FIELD_HEIGHT - SPRITE_HEIGHT + 1);
+void StudentWorld::setRandomSeed(unsigned long long seed) {
+    m_random.setSeed(seed);
+}
 
-            if (x + SPRITE_WIDTH -1 >= TUNNEL_SHAFT_X_START && x <= TUNNEL_SHAFT_X_END &&
-                y + SPRITE_HEIGHT -1 >= TUNNEL_SHAFT_Y_BOTTOM_NO_EARTH && y <= TUNNEL_SHAFT_Y_TOP) {
-                 placed = false; continue;
-            }
-            if (isAnyObjectNearby(x,y,6.0, false)) {placed = false; continue;}
-        } while (!placed);
-        addActor(new Gold(this, x, y));
-    }
-
-    int numBarrels = std::min(2 + currentLevel, 21);
-    m_barrelsRemaining = numBarrels;
-    for (int i = 0; i < numBarrels; ++i) {
-        int x, y;
-        bool placed;
-        do {
-            placed = true;
-            x = rand() % (OIL_FIELD_WIDTH - SPRITE_WIDTH + 1);
-            y = rand() % (EARTH_FIELD_HEIGHT - SPRITE_HEIGHT + 1);
-            if (x + SPRITE_WIDTH -1 >= TUNNEL_SHAFT_X_START && x <= TUNNEL_SHAFT_X_END &&
-                y + SPRITE_HEIGHT -1 >= TUNNEL_SHAFT_Y_BOTTOM_NO_EARTH && y <= TUNNEL_SHAFT_Y_TOP) {
-                 placed = false; continue;
+namespace {
+    void writeActor(ByteWriter& out, const Actor& actor) {
+        out.writeByte(static_cast<unsigned char>(actor.getKind()));
+        out.writeInt(actor.getX());
+        out.writeInt(actor.getY());
+        actor.saveState(out);
+    }
+}
+
+void StudentWorld::writeSnapshot(ByteWriter& out) const {
+    writeState(out, true);
+}
+
+void StudentWorld::writeState(ByteWriter& out, bool withPathCache) const {
+    out.writeVarint(getLives());
+    out.writeVarint(getScore());
+    out.writeVarint(getLevel());
+    out.writeVarint(getTick());
+    out.writeInt(m_barrelsRemaining);
+    out.writeInt(m_ticksSinceLastProtesterAdded);
+    out.writeInt(m_targetNumberOfProtesters);
+    out.writeInt(m_currentNumberOfProtestersOnField);
+
+    for (int x = 0; x < OIL_FIELD_WIDTH; ++x) {
+        out.writeFixed64(m_earthColumns[x]);
+    }
+
+    out.writeBool(m_tunnelman != nullptr);
+    if (m_tunnelman) {
+        writeActor(out, *m_tunnelman);
+    }
+    out.writeVarint(m_actors.size());
+    for (const Actor* actor : m_actors) {
+        writeActor(out, *actor);
+    }
+
+    out.writeVarint(m_topologyVersion);
+    if (withPathCache) {
+        m_pathCache.save(out, m_topologyVersion);
+    } else {
+        out.writeVarint(0);
+    }
+
+    const RandomGenerator::State& random = m_random.getState();
+    for (int i = 0; i < 4; ++i) {
+        out.writeFixed64(random.s[i]);
+    }
+}
+
+// The small fields are spread by distinct odd multipliers and summed, so the multiplies run side
+// by side; only the total goes through the full mixer.
+unsigned long long StudentWorld::getStateHash() const {
+    const RandomGenerator::State& random = m_random.getState();
+    return finalizeHash(m_earthHash + m_actorHash +
+        (static_cast<unsigned long long>(getLives()) << 32 | getLevel()) * 0x9E3779B97F4A7C15ULL +
+        (static_cast<unsigned long long>(getScore()) << 32 | static_cast<unsigned int>(m_barrelsRemaining)) * 0xC2B2AE3D27D4EB4FULL +
+        (static_cast<unsigned long long>(m_ticksSinceLastProtesterAdded) << 32 |
+         static_cast<unsigned long long>(m_targetNumberOfProtesters & 0xFFFF) << 16 |
+         static_cast<unsigned int>(m_currentNumberOfProtestersOnField & 0xFFFF)) * 0x165667B19E3779F9ULL +
+        random.s[0] * 0xD6E8FEB86659FD93ULL + random.s[1] * 0xA0761D6478BD642FULL +
+        random.s[2] * 0xE7037ED1A0B428DBULL + random.s[3] * 0x8EBC6AF09C88C6E3ULL);
+}
+
+bool StudentWorld::actorHashIsConsistent() const {
+    unsigned long long sum = 0;
+    if (m_tunnelman != nullptr && m_tunnelman->isHashTracked()) {
+        sum += m_tunnelman->getStateHashTerm();
+    }
+    for (const Actor* actor : m_actors) {
+        if (actor->isHashTracked()) {
+            sum += actor->getStateHashTerm();
+        }
+    }
+    return sum == m_actorHash;
+}
+
+// Reads the kind and position, builds the actor there and lets it read the rest of its record.
+bool StudentWorld::readActor(ByteReader& in, Actor*& actor) {
+    unsigned char kind;
+    int x, y;
+    actor = nullptr;
+    if (!in.readByte(kind) || !in.readInt(x) || !in.readInt(y) ||
+        x < 0 || x > OIL_FIELD_WIDTH - SPRITE_WIDTH || y < 0 || y > GAME_BOARD_HEIGHT - SPRITE_HEIGHT) {
+        return false;
+    }
+    if (kind == Actor::KIND_TUNNELMAN) {
+        if (m_tunnelman == nullptr) {
+            m_tunnelman = new TunnelMan(this);
+            m_tunnelman->setHashTracked(true);
+        }
+        m_tunnelman->teleportTo(x, y);
+        actor = m_tunnelman;
+    } else {
+        actor = Actor::createForRestore(kind, this, x, y);
+        if (actor == nullptr) {
+            return false;
+        }
+        addActor(actor);
+    }
+    return actor->loadState(in);
+}
+
+bool StudentWorld::readSnapshot(ByteReader& in) {
+    unsigned long long lives, score, level, tick;
+    int barrels, ticksSinceProtester, targetProtesters, protestersOnField;
+    if (!in.readVarint(lives) || !in.readVarint(score) || !in.readVarint(level) || !in.readVarint(tick) ||
+        !in.readInt(barrels) || !in.readInt(ticksSinceProtester) || !in.readInt(targetProtesters) ||
+        !in.readInt(protestersOnField)) {
+        return false;
+    }
+    unsigned long long columns[OIL_FIELD_WIDTH];
+    for (int x = 0; x < OIL_FIELD_WIDTH; ++x) {
+        if (!in.readFixed64(columns[x]) || (columns[x] >> EARTH_FIELD_HEIGHT) != 0) return false;
+    }
+
+    // A layout being built in the background belongs to the timeline we are leaving.
+    if (m_nextLayout.valid()) {
+        m_nextLayout.get();
+    }
+    // Path data only depends on earth and boulders, so only what differs from the saved field has
+    // to be invalidated: changed cells, and the ground around old and new boulders.
+    for (Actor* actor : m_actors) {
+        if (actor->getKind() == Actor::KIND_BOULDER) {
+            topologyChangedAt(actor->getX() - 3, actor->getY() - 3, actor->getX() + 3, actor->getY() + 3);
+        }
+    }
+    deleteActors();
+    restoreCounters(static_cast<unsigned int>(lives), static_cast<unsigned int>(score),
+                    static_cast<unsigned int>(level), static_cast<unsigned long>(tick));
+    m_barrelsRemaining = barrels;
+    m_ticksSinceLastProtesterAdded = ticksSinceProtester;
+    m_targetNumberOfProtesters = targetProtesters;
+    m_currentNumberOfProtestersOnField = protestersOnField;
+    m_lastAnnoyanceSource = nullptr;
+
+    // Only cells that differ from the current field are touched, so restoring a snapshot of the
+    // same level costs a few digs rather than a whole new field.
+    for (int x = 0; x < OIL_FIELD_WIDTH; ++x) {
+        unsigned long long changed = m_earthColumns[x] ^ columns[x];
+        for (int y = 0; changed != 0; ++y, changed >>= 1) {
+            if ((changed & 1) == 0) continue;
+            if ((columns[x] >> y) & 1) {
+                placeEarth(x, y);
+            } else {
+                releaseEarth(x, y);
+                setEarthMaskBit(x, y, false);
             }
-            if (isAnyObjectNearby(x,y,6.0, false)) {placed = false; continue;}
-        } while (!placed);
-        addActor(new BarrelOfOil(this, x, y));
+            topologyChangedAt(x - SPRITE_WIDTH + 1, y - SPRITE_HEIGHT + 1, x, y);
+        }
+    }
+
+    bool hasTunnelMan;
+    unsigned long long count;
+    Actor* actor;
+    bool ok = in.readBool(hasTunnelMan) && (!hasTunnelMan || (readActor(in, actor) && actor == m_tunnelman)) &&
+              in.readVarint(count);
+    for (unsigned long long i = 0; ok && i < count; ++i) {
+        ok = readActor(in, actor) && actor != m_tunnelman;
+    }
+    if (ok && !hasTunnelMan) {
+        delete m_tunnelman;
+        m_tunnelman = nullptr;
+    }
+
+    // Building the actors dug under boulders and drew protester wanders; the saved version and
+    // generator state below replace whatever that did.
+    rebuildBoulderMasks();
+    for (Actor* restored : m_actors) {
+        if (restored->getKind() == Actor::KIND_BOULDER) {
+            topologyChangedAt(restored->getX() - 3, restored->getY() - 3, restored->getX() + 3, restored->getY() + 3);
+        }
+    }
+    m_walkabilitySnapshot.reset();
+
+    unsigned long long version;
+    RandomGenerator::State random;
+    ok = ok && in.readVarint(version) && m_pathCache.load(in, static_cast<unsigned long>(version));
+    for (int i = 0; ok && i < 4; ++i) {
+        ok = in.readFixed64(random.s[i]);
+    }
+    if (!ok) {
+        cleanUp();
+        return false;
+    }
+    m_topologyVersion = static_cast<unsigned long>(version);
+    m_random.setState(random);
+    return true;
+}
+
+LevelLayout StudentWorld::takeLevelLayout() {
+    if (m_nextLayout.valid()) {
+        LevelLayout layout = m_nextLayout.get();
+        if (layout.level == static_cast<int>(getLevel())) {
+            return layout;
+        }
+    }
+    return generateLevelLayout(getLevel(), m_random.next());
+}
+
+void StudentWorld::populateOilFieldWithObjects(const LevelLayout& layout) {
+    for (const LevelObject& spot : layout.boulders) {
+        addActor(new Boulder(this, spot.x, spot.y));
+    }
+    for (const LevelObject& spot : layout.gold) {
+        addActor(new Gold(this, spot.x, spot.y));
+    }
+    m_barrelsRemaining = static_cast<int>(layout.barrels.size());
+    for (const LevelObject& spot : layout.barrels) {
+        addActor(new BarrelOfOil(this, spot.x, spot.y));
     }
 }
 
 
 int StudentWorld::move() {
+    if (m_rewind.isEnabled()) {
+        ByteWriter out;
+        writeState(out, false);
+        m_rewind.push(out.bytes());
+    }
     updateGameStatText();
+    m_pathScheduler.beginTick();
+    if (m_pathService) {
+        m_pathService->collect();
+    }
 
     m_ticksSinceLastProtesterAdded++;
 
@@ -170,27 +444,92 @@ int StudentWorld::move() {
 }
 
 void StudentWorld::cleanUp() {
-    delete m_tunnelman;
-    m_tunnelman = nullptr;
+    auto start = chrono::steady_clock::now();
+    if (!m_inPlaceReset) {
+        delete m_tunnelman;
+        m_tunnelman = nullptr;
+    }
 
-    for (int i = 0; i < OIL_FIELD_WIDTH; ++i) {
-        for (int j = 0; j < EARTH_FIELD_HEIGHT; ++j) {
-            delete m_earth[i][j];
-            m_earth[i][j] = nullptr;
+    if (m_earthSprites) {
+        for (int i = 0; i < OIL_FIELD_WIDTH; ++i) {
+            for (int j = 0; j < EARTH_FIELD_HEIGHT; ++j) {
+                releaseEarth(i, j);
+            }
         }
     }
 
+    deleteActors();
+
+    for (int i = 0; i < BLOCKER_MASK_LINES; ++i) {
+        m_earthRows[i] = m_earthColumns[i] = 0;
+        m_boulderRows[i] = m_boulderColumns[i] = 0;
+    }
+    m_earthHash = 0;
+    m_rewind.clear();
+    m_lastCleanUpMicros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+}
+
+void StudentWorld::deleteActors() {
     for (Actor* actor : m_actors) {
         delete actor;
     }
     m_actors.clear();
+    m_protesters.clear();
+}
+
+void StudentWorld::setInPlaceReset(bool enabled) {
+    m_inPlaceReset = enabled;
+    if (!enabled) {
+        releaseEarthStorage();
+    }
+}
+
+void StudentWorld::placeEarth(int x, int y) {
+    if (!m_earthSprites) {
+        // nothing to draw
+    } else if (m_inPlaceReset) {
+        if (m_earthStorage[x][y] == nullptr) {
+            m_earthStorage[x][y] = new Earth(this, x, y);
+        } else {
+            m_earthStorage[x][y]->setVisibleWithCheck(true);
+        }
+        m_earth[x][y] = m_earthStorage[x][y];
+    } else {
+        m_earth[x][y] = new Earth(this, x, y);
+    }
+    setEarthMaskBit(x, y, true);
+}
+
+void StudentWorld::releaseEarth(int x, int y) {
+    if (m_earth[x][y] == nullptr) {
+        return;
+    }
+    if (m_earth[x][y] == m_earthStorage[x][y]) {
+        m_earth[x][y]->setVisibleWithCheck(false);
+    } else {
+        delete m_earth[x][y];
+    }
+    m_earth[x][y] = nullptr;
+}
+
+// Hands earth that is currently in play over to m_earth and frees the hidden rest.
+void StudentWorld::releaseEarthStorage() {
+    for (int i = 0; i < OIL_FIELD_WIDTH; ++i) {
+        for (int j = 0; j < EARTH_FIELD_HEIGHT; ++j) {
+            if (m_earthStorage[i][j] != m_earth[i][j]) {
+                delete m_earthStorage[i][j];
+            }
+            m_earthStorage[i][j] = nullptr;
+        }
+    }
 }
 
 bool StudentWorld::removeEarth(int x, int y) {
     if (x >= 0 && x < OIL_FIELD_WIDTH && y >= 0 && y < EARTH_FIELD_HEIGHT) {
-        if (m_earth[x][y] != nullptr) {
-            delete m_earth[x][y];
-            m_earth[x][y] = nullptr;
+        if (isEarthAt(x, y)) {
+            releaseEarth(x, y);
+            setEarthMaskBit(x, y, false);
+            topologyChangedAt(x - SPRITE_WIDTH + 1, y - SPRITE_HEIGHT + 1, x, y);
             return true;
         }
     }
@@ -201,7 +540,7 @@ bool StudentWorld::isEarthAt(int x, int y) const {
     if (x < 0 || x >= OIL_FIELD_WIDTH || y < 0 || y >= EARTH_FIELD_HEIGHT) {
         return false;
     }
-    return m_earth[x][y] != nullptr;
+    return ((m_earthColumns[x] >> y) & 1) != 0;
 }
 
 bool StudentWorld::isEarthBelowBoulder(int x_boulder_left, int y_boulder_bottom) const {
@@ -225,7 +564,7 @@ bool StudentWorld::isEarthUnderneath4x4(int x_topLeft, int y_topLeft) const {
 }
 
 
-bool StudentWorld::isBoulderAtLocation(int x, int y, double checkRadius) const {
+bool StudentWorld::isBoulderAtLocation(int x, int y, int checkRadius) const {
     for (Actor* actor : m_actors) {
         if (actor->isAlive() && dynamic_cast<Boulder*>(actor)) {
             if (x < actor->getX() + SPRITE_WIDTH && x + SPRITE_WIDTH > actor->getX() &&
@@ -233,9 +572,8 @@ bool StudentWorld::isBoulderAtLocation(int x, int y, double checkRadius) const {
                 return true;
             }
           
-            if (checkRadius > 0.0) {
-                 if (distance(x + SPRITE_WIDTH/2.0, y + SPRITE_HEIGHT/2.0,
-                              actor->getX() + SPRITE_WIDTH/2.0, actor->getY() + SPRITE_HEIGHT/2.0) <= checkRadius) {
+            if (checkRadius > 0) {
+                 if (isWithinRadius(x, y, actor->getX(), actor->getY(), checkRadius)) {
                     return true;
                 }
             }
@@ -247,9 +585,7 @@ bool StudentWorld::isBoulderAtLocation(int x, int y, double checkRadius) const {
 bool StudentWorld::isBoulderBlockingTunnelMan(int targetManX, int targetManY) const {
     for (Actor* actor : m_actors) {
         if (actor->isAlive() && dynamic_cast<Boulder*>(actor)) {
-            double dist = distance(targetManX + SPRITE_WIDTH / 2.0, targetManY + SPRITE_HEIGHT / 2.0,
-                                   actor->getX() + SPRITE_WIDTH / 2.0, actor->getY() + SPRITE_HEIGHT / 2.0);
-            if (dist <= 3.0) {
+            if (isWithinRadius(targetManX, targetManY, actor->getX(), actor->getY(), 3)) {
                 return true;
             }
         }
@@ -269,8 +605,7 @@ bool StudentWorld::canSquirtExistAt(int x, int y) const {
     }
     for (Actor* actor : m_actors) {
         if (actor->isAlive() && dynamic_cast<Boulder*>(actor)) {
-            if (distance(x + SPRITE_WIDTH / 2.0, y + SPRITE_HEIGHT / 2.0,
-                         actor->getX() + SPRITE_WIDTH / 2.0, actor->getY() + SPRITE_HEIGHT / 2.0) <= 3.0) {
+            if (isWithinRadius(x, y, actor->getX(), actor->getY(), 3)) {
                 return false;
             }
         }
@@ -281,62 +616,79 @@ bool StudentWorld::canSquirtExistAt(int x, int y) const {
 
 void StudentWorld::addActor(Actor* actor) {
     m_actors.push_back(actor);
+    actor->setHashTracked(true);
+    if (Protester* p = dynamic_cast<Protester*>(actor)) {
+        m_protesters.push_back(p);
+    }
+}
+
+int StudentWorld::findProtestersInRadius(int centerX, int centerY, int radius) {
+    int count = static_cast<int>(m_protesters.size());
+    m_protesterX.resize(count);
+    m_protesterY.resize(count);
+    m_protesterHits.resize((count + 63) / 64);
+    for (int i = 0; i < count; ++i) {
+        m_protesterX[i] = m_protesters[i]->getX();
+        m_protesterY[i] = m_protesters[i]->getY();
+    }
+    findWithinRadius(m_protesterX.data(), m_protesterY.data(), count, centerX, centerY, radius, m_protesterHits.data());
+    return count;
+}
+
+bool StudentWorld::isProtesterHit(int index) const {
+    return (m_protesterHits[index / 64] >> (index % 64)) & 1;
 }
 
-void StudentWorld::revealNearbyObjects(int centerX, int centerY, double radius) {
+void StudentWorld::revealNearbyObjects(int centerX, int centerY, int radius) {
     for (Actor* actor : m_actors) {
         if (dynamic_cast<BarrelOfOil*>(actor) ||
             (dynamic_cast<Gold*>(actor) && static_cast<Gold*>(actor)->getGoldState() == Gold::State::PERMANENT_FOR_TUNNELMAN) ) {
-            if (!actor->isVisible() && distance(centerX, centerY, actor->getX(), actor->getY()) <= radius) {
+            if (!actor->isVisible() && isWithinRadius(centerX, centerY, actor->getX(), actor->getY(), radius)) {
                 actor->setVisibleWithCheck(true);
             }
         }
     }
 }
 
-bool StudentWorld::annoyProtestersInRadius(Actor* instigator, int centerX, int centerY, double radius, int damage) {
+bool StudentWorld::annoyProtestersInRadius(Actor* instigator, int centerX, int centerY, int radius, int damage) {
     bool annoyedSomeone = false;
     m_lastAnnoyanceSource = instigator;
-    for (Actor* actor : m_actors) {
-        Protester* p = dynamic_cast<Protester*>(actor);
-        if (p && p->isAlive() && p->canBeHit()) {
-            if (distance(centerX, centerY, p->getX(), p->getY()) <= radius) {
-                p->annoy(damage);
-                annoyedSomeone = true;
-            }
+    int count = findProtestersInRadius(centerX, centerY, radius);
+    for (int i = 0; i < count; ++i) {
+        Protester* p = m_protesters[i];
+        if (isProtesterHit(i) && p->isAlive() && p->canBeHit()) {
+            p->annoy(damage);
+            annoyedSomeone = true;
         }
     }
     return annoyedSomeone;
 }
 
-void StudentWorld::damageActorsInRadius(Actor* instigatorBoulder, int centerX, int centerY, double radius, int damage) {
+void StudentWorld::damageActorsInRadius(Actor* instigatorBoulder, int centerX, int centerY, int radius, int damage) {
     m_lastAnnoyanceSource = instigatorBoulder;
 
     if (m_tunnelman->isAlive() && m_tunnelman->canBeBonked()) {
-        if (distance(centerX, centerY, m_tunnelman->getX(), m_tunnelman->getY()) <= radius) {
+        if (isWithinRadius(centerX, centerY, m_tunnelman->getX(), m_tunnelman->getY(), radius)) {
             m_tunnelman->annoy(damage);
         }
     }
-    for (Actor* actor : m_actors) {
-        Protester* p = dynamic_cast<Protester*>(actor);
-        if (p && p->isAlive() && p->canBeBonked()) {
-            if (distance(centerX, centerY, p->getX(), p->getY()) <= radius) {
-                if(p->annoy(damage)){
-                }
-            }
+    int count = findProtestersInRadius(centerX, centerY, radius);
+    for (int i = 0; i < count; ++i) {
+        Protester* p = m_protesters[i];
+        if (isProtesterHit(i) && p->isAlive() && p->canBeBonked()) {
+            p->annoy(damage);
         }
     }
 }
 
 bool StudentWorld::checkAndHandleProtesterGoldPickup(Gold* nugget, int goldX, int goldY) {
-    for (Actor* actor : m_actors) {
-        Protester* p = dynamic_cast<Protester*>(actor);
-        if (p && p->isAlive() && p->canPickUpGold()) {
-            if (distance(goldX, goldY, p->getX(), p->getY()) <= 3.0) {
-                p->acceptGold();
-                nugget->setPickedUpByProtester(true);
-                return true;
-            }
+    int count = findProtestersInRadius(goldX, goldY, 3);
+    for (int i = 0; i < count; ++i) {
+        Protester* p = m_protesters[i];
+        if (isProtesterHit(i) && p->isAlive() && p->canPickUpGold()) {
+            p->acceptGold();
+            nugget->setPickedUpByProtester(true);
+            return true;
         }
     }
     return false;
@@ -355,6 +707,9 @@ void StudentWorld::decrementBarrelsRemaining() {
 
 
 void StudentWorld::removeDeadActors() {
+    m_protesters.erase(std::remove_if(m_protesters.begin(), m_protesters.end(),
+                                      [](const Protester* p) { return !p->isAlive(); }),
+                       m_protesters.end());
     for (auto it = m_actors.begin(); it != m_actors.end(); ) {
         if (!(*it)->isAlive()) {
             if (dynamic_cast<Protester*>(*it)) {
@@ -376,7 +731,7 @@ void StudentWorld::addNewActorsDuringTick() {
 
     if (m_ticksSinceLastProtesterAdded >= ticksToWaitProtester && m_currentNumberOfProtestersOnField < m_targetNumberOfProtesters) {
         int probabilityOfHardcore = std::min(90, currentLevel * 10 + 30);
-        if ((rand() % 100) < probabilityOfHardcore) {
+        if (m_random.nextInt(100) < probabilityOfHardcore) {
             addActor(new HardcoreProtester(this, 0));
         } else {
             addActor(new RegularProtester(this, 0));
@@ -386,16 +741,16 @@ void StudentWorld::addNewActorsDuringTick() {
     }
 
     int G_goodieChance = currentLevel * 25 + 300;
-    if ((rand() % G_goodieChance) == 0) {
+    if (m_random.nextInt(G_goodieChance) == 0) {
         int goodieLifetime = std::max(100, 300 - 10 * currentLevel);
-        if ((rand() % 5) == 0) {
+        if (m_random.nextInt(5) == 0) {
             addActor(new SonarKit(this, 0, 60, goodieLifetime));
         } else {
             int wx, wy;
             bool spotFound = false;
             for(int attempt = 0; attempt < 50; ++attempt) {
-                wx = rand() % (OIL_FIELD_WIDTH - SPRITE_WIDTH + 1);
-                wy = rand() % (EARTH_FIELD_HEIGHT - SPRITE_HEIGHT + 1);
+                wx = m_random.nextInt(OIL_FIELD_WIDTH - SPRITE_WIDTH + 1);
+                wy = m_random.nextInt(EARTH_FIELD_HEIGHT - SPRITE_HEIGHT + 1);
 
                 bool clearSpot = true;
                 for(int r = 0; r < SPRITE_HEIGHT; ++r) {
@@ -406,7 +761,7 @@ void StudentWorld::addNewActorsDuringTick() {
                     }
                     if(!clearSpot) break;
                 }
-                if(clearSpot && !isAnyObjectNearby(wx, wy, 0.0, false)) {
+                if(clearSpot && !isAnyObjectNearby(wx, wy, 0, false)) {
                     addActor(new WaterPool(this, wx, wy, goodieLifetime));
                     spotFound = true;
                     break;
@@ -430,15 +785,15 @@ void StudentWorld::updateGameStatText() {
     setGameStatText(oss.str());
 }
 
-bool StudentWorld::isAnyObjectNearby(int x, int y, double radius, bool checkOnlyBoulders) const {
+bool StudentWorld::isAnyObjectNearby(int x, int y, int radius, bool checkOnlyBoulders) const {
     if (m_tunnelman && m_tunnelman->isAlive()) {
-         if (distance(x,y,m_tunnelman->getX(), m_tunnelman->getY()) <= radius) return true;
+         if (isWithinRadius(x, y, m_tunnelman->getX(), m_tunnelman->getY(), radius)) return true;
     }
     for (const auto* actor : m_actors) {
         if (!actor->isAlive()) continue;
         if (checkOnlyBoulders && !dynamic_cast<const Boulder*>(actor)) continue;
 
-        if (distance(x,y,actor->getX(), actor->getY()) <= radius) {
+        if (isWithinRadius(x, y, actor->getX(), actor->getY(), radius)) {
             return true;
         }
     }
@@ -446,14 +801,6 @@ bool StudentWorld::isAnyObjectNearby(int x, int y, double radius, bool checkOnly
 }
 
 
-double StudentWorld::distance(int x1, int y1, int x2, int y2) const {
-    double c_x1 = x1 + SPRITE_WIDTH / 2.0;
-    double c_y1 = y1 + SPRITE_HEIGHT / 2.0;
-    double c_x2 = x2 + SPRITE_WIDTH / 2.0;
-    double c_y2 = y2 + SPRITE_HEIGHT / 2.0;
-    return std::sqrt(pow(c_x1 - c_x2, 2) + pow(c_y1 - c_y2, 2));
-}
-
 bool StudentWorld::canProtesterMoveTo(const Protester* protester, int targetX, int targetY) const {
     if (targetX < 0 || targetX + SPRITE_WIDTH > OIL_FIELD_WIDTH ||
         targetY < 0 || targetY + SPRITE_HEIGHT > GAME_BOARD_HEIGHT) {
@@ -466,7 +813,7 @@ bool StudentWorld::canProtesterMoveTo(const Protester* protester, int targetX, i
     }
     for (const auto* actor : m_actors) {
         if (actor->isAlive() && dynamic_cast<const Boulder*>(actor)) {
-            if (distance(targetX, targetY, actor->getX(), actor->getY()) <= 3.0) {
+            if (isWithinRadius(targetX, targetY, actor->getX(), actor->getY(), 3)) {
                 return false;
             }
         }
@@ -486,123 +833,415 @@ bool StudentWorld::hasClearPathToTunnelMan(const Protester* protester, int start
     path_dist_out = 0;
 
    
+    // Every cell the walk below would have tested is one row or column range in the blocker masks.
     if (startX == tmX_bl) {
-        int step = (startY < tmY_bl) ? 1 : -1;
-        int currentY = startY;
-        while (currentY != tmY_bl) {
-            currentY += step;
-            path_dist_out++;
-            if (path_dist_out > VIEW_HEIGHT) return false;
-            for (int i = 0; i < SPRITE_WIDTH; ++i) {
-                 if (isEarthAt(startX + i, currentY) || isBoulderAtLocation(startX + i, currentY, 0.0)) return false;
-            }
-        }
-        return true;
+        path_dist_out = std::abs(tmY_bl - startY);
+        if (path_dist_out > VIEW_HEIGHT) return false;
+        if (path_dist_out == 0) return true;
+        int lo = (tmY_bl > startY) ? startY + 1 : tmY_bl;
+        int hi = (tmY_bl > startY) ? tmY_bl : startY - 1;
+        return !isLineRangeBlocked(m_earthColumns, startX, startX + SPRITE_WIDTH - 1, lo, hi) &&
+               !isLineRangeBlocked(m_boulderColumns, startX, startX + 2 * SPRITE_WIDTH - 2, lo, hi + SPRITE_HEIGHT - 1);
     } else if (startY == tmY_bl) {
-        int step = (startX < tmX_bl) ? 1 : -1;
-        int currentX = startX;
-        while (currentX != tmX_bl) {
-            currentX += step;
-            path_dist_out++;
-            if (path_dist_out > VIEW_WIDTH) return false;
-            for (int i = 0; i < SPRITE_HEIGHT; ++i) {
-                if (isEarthAt(currentX, startY + i) || isBoulderAtLocation(currentX, startY + i, 0.0)) return false;
+        path_dist_out = std::abs(tmX_bl - startX);
+        if (path_dist_out > VIEW_WIDTH) return false;
+        int lo = (tmX_bl > startX) ? startX + 1 : tmX_bl;
+        int hi = (tmX_bl > startX) ? tmX_bl : startX - 1;
+        return !isLineRangeBlocked(m_earthRows, startY, startY + SPRITE_HEIGHT - 1, lo, hi) &&
+               !isLineRangeBlocked(m_boulderRows, startY, startY + 2 * SPRITE_HEIGHT - 2, lo, hi + SPRITE_WIDTH - 1);
+    }
+    return false;
+}
+
+// True if any of lines[first..last] has a bit set in [lo, hi]. Works for both the per-row and the
+// per-column masks, since each line is just a 64-bit set of positions along it.
+bool StudentWorld::isLineRangeBlocked(const unsigned long long lines[], int first, int last, int lo, int hi) const {
+    last = std::min(last, BLOCKER_MASK_LINES - 1);
+    hi = std::min(hi, BLOCKER_MASK_LINES - 1);
+    if (first < 0 || lo < 0 || first > last || lo > hi) return false;
+
+    unsigned long long range = (hi == 63 ? ~0ULL : ((1ULL << (hi + 1)) - 1)) & ~((1ULL << lo) - 1);
+    for (int i = first; i <= last; ++i) {
+        if (lines[i] & range) return true;
+    }
+    return false;
+}
+
+void StudentWorld::setEarthMaskBit(int x, int y, bool present) {
+    if (((m_earthColumns[x] >> y) & 1) != (present ? 1u : 0u)) {
+        m_earthHash ^= zobristKey(x, y);
+    }
+    if (present) {
+        m_earthRows[y] |= (1ULL << x);
+        m_earthColumns[x] |= (1ULL << y);
+    } else {
+        m_earthRows[y] &= ~(1ULL << x);
+        m_earthColumns[x] &= ~(1ULL << y);
+    }
+}
+
+void StudentWorld::rebuildBoulderMasks() {
+    for (int i = 0; i < BLOCKER_MASK_LINES; ++i) {
+        m_boulderRows[i] = 0;
+        m_boulderColumns[i] = 0;
+    }
+    for (const Actor* actor : m_actors) {
+        if (!actor->isAlive() || !dynamic_cast<const Boulder*>(actor)) continue;
+        for (int i = 0; i < SPRITE_WIDTH; ++i) {
+            for (int j = 0; j < SPRITE_HEIGHT; ++j) {
+                int x = actor->getX() + i;
+                int y = actor->getY() + j;
+                if (x < 0 || x >= BLOCKER_MASK_LINES || y < 0 || y >= BLOCKER_MASK_LINES) continue;
+                m_boulderRows[y] |= (1ULL << x);
+                m_boulderColumns[x] |= (1ULL << y);
             }
         }
-        return true;
     }
-    return false;
 }
 
 
-struct PathfindingNode {
-    int x, y, dist;
-    Actor::Direction firstStepDir;
-    vector<Actor::Direction> m_path;
+namespace {
+
+const int MAX_PATH_SEARCH_DEPTH = 200;
+
+const int PATH_DX[] = {0, 0, -1, 1};
+const int PATH_DY[] = {1, -1, 0, 0};
+const Actor::Direction PATH_DIRS[] = {Actor::up, Actor::down, Actor::left, Actor::right};
+
+struct AStarNode {
+    int f, h, x, y;
 };
 
-Actor::Direction StudentWorld::getPathToCoordinate(int startX, int startY, int endX, int endY) {
-    queue<PathfindingNode> q;
-    vector<vector<bool>> visited(OIL_FIELD_WIDTH, vector<bool>(GAME_BOARD_HEIGHT, false));
+// Lowest f first; on equal f prefer the node closest to the goal.
+struct AStarNodeCompare {
+    bool operator()(const AStarNode& a, const AStarNode& b) const {
+        if (a.f != b.f) return a.f > b.f;
+        return a.h > b.h;
+    }
+};
 
-    if(startX < 0 || startX >= OIL_FIELD_WIDTH || startY < 0 || startY >= GAME_BOARD_HEIGHT ||
-       endX < 0 || endX >= OIL_FIELD_WIDTH || endY < 0 || endY >= GAME_BOARD_HEIGHT) return Actor::none;
+int manhattan(int x1, int y1, int x2, int y2) {
+    return std::abs(x1 - x2) + std::abs(y1 - y2);
+}
 
+}
 
-    q.push({startX, startY, 0, Actor::none, {}});
-    visited[startX][startY] = true;
+bool StudentWorld::isPathCoordinateInBounds(int x, int y) const {
+    return x >= 0 && x < OIL_FIELD_WIDTH && y >= 0 && y < GAME_BOARD_HEIGHT;
+}
 
-    int dx_move[] = {0, 0, -1, 1};
-    int dy_move[] = {1, -1, 0, 0};
-    Actor::Direction dirs[] = {Actor::up, Actor::down, Actor::left, Actor::right};
+int StudentWorld::findPathLength(int startX, int startY, int endX, int endY, int maxLength, int* firstStepIndex) {
+    int gScore[OIL_FIELD_WIDTH][GAME_BOARD_HEIGHT];
+    int firstStep[OIL_FIELD_WIDTH][GAME_BOARD_HEIGHT];
+    bool closed[OIL_FIELD_WIDTH][GAME_BOARD_HEIGHT];
 
-    while (!q.empty()) {
-        PathfindingNode curr = q.front();
-        q.pop();
+    for (int i = 0; i < OIL_FIELD_WIDTH; ++i) {
+        for (int j = 0; j < GAME_BOARD_HEIGHT; ++j) {
+            gScore[i][j] = -1;
+            closed[i][j] = false;
+        }
+    }
+
+    priority_queue<AStarNode, vector<AStarNode>, AStarNodeCompare> open;
+    int h0 = manhattan(startX, startY, endX, endY);
+    if (h0 > maxLength) return -1;
 
+    gScore[startX][startY] = 0;
+    firstStep[startX][startY] = -1;
+    open.push({h0, h0, startX, startY});
+
+    while (!open.empty()) {
+        AStarNode curr = open.top();
+        open.pop();
+        if (closed[curr.x][curr.y]) continue;
+        closed[curr.x][curr.y] = true;
+
+        int g = gScore[curr.x][curr.y];
         if (curr.x == endX && curr.y == endY) {
-            if (!curr.m_path.empty()) return curr.m_path[0];
-            return Actor::none;
+            if (firstStepIndex) *firstStepIndex = firstStep[curr.x][curr.y];
+            return g;
         }
 
-        if (curr.dist > 200) continue;
+        ++m_lastPathNodesExpanded;
 
         for (int i = 0; i < 4; ++i) {
-            int nextX = curr.x + dx_move[i];
-            int nextY = curr.y + dy_move[i];
-
-            if (nextX >= 0 && nextX < OIL_FIELD_WIDTH && nextY >= 0 && nextY < GAME_BOARD_HEIGHT) {
-                if (canProtesterMoveTo(nullptr, nextX, nextY) && !visited[nextX][nextY]) {
-                    visited[nextX][nextY] = true;
-                    std::vector<Actor::Direction> newPath = curr.m_path;
-                    newPath.push_back(dirs[i]);
-                    q.push({nextX, nextY, curr.dist + 1, (newPath.empty() ? Actor::none : newPath[0]), newPath});
-                }
+            int nextX = curr.x + PATH_DX[i];
+            int nextY = curr.y + PATH_DY[i];
+            if (!isPathCoordinateInBounds(nextX, nextY) || closed[nextX][nextY]) continue;
+
+            int nextG = g + 1;
+            int nextH = manhattan(nextX, nextY, endX, endY);
+            if (nextG + nextH > maxLength) continue;
+            if (gScore[nextX][nextY] != -1 && gScore[nextX][nextY] <= nextG) continue;
+            if (!canProtesterMoveTo(nullptr, nextX, nextY)) continue;
+
+            gScore[nextX][nextY] = nextG;
+            firstStep[nextX][nextY] = (g == 0 ? i : firstStep[curr.x][curr.y]);
+            open.push({nextG + nextH, nextH, nextX, nextY});
+        }
+    }
+    return -1;
+}
+
+PathCache::Key StudentWorld::makePathCacheKey(PathCache::QueryKind kind, int startX, int startY, int endX, int endY, int limit) const {
+    PathCache::Key key;
+    key.version = m_topologyVersion;
+    key.kind = kind;
+    key.startX = startX;
+    key.startY = startY;
+    key.endX = endX;
+    key.endY = endY;
+    key.limit = limit;
+    return key;
+}
+
+void StudentWorld::setAsyncPathfinding(bool enabled, int threadCount) {
+    if (!enabled) {
+        m_pathService.reset();
+    } else if (!m_pathService || (threadCount > 0 && m_pathService->getThreadCount() != threadCount)) {
+        m_pathService.reset(new PathService(threadCount));
+    }
+}
+
+void StudentWorld::releasePathRequest(PathRequest& request) {
+    if (m_pathService && request.pendingTicket != 0) {
+        m_pathService->cancel(request.pendingTicket);
+    }
+    request.pendingTicket = 0;
+}
+
+shared_ptr<const WalkabilitySnapshot> StudentWorld::getWalkabilitySnapshot() {
+    if (m_walkabilitySnapshot && m_walkabilitySnapshot->version == m_topologyVersion) {
+        return m_walkabilitySnapshot;
+    }
+    const int w = OIL_FIELD_WIDTH - SPRITE_WIDTH + 1;
+    const int h = GAME_BOARD_HEIGHT - SPRITE_HEIGHT + 1;
+    shared_ptr<WalkabilitySnapshot> snapshot = make_shared<WalkabilitySnapshot>();
+    snapshot->width = w;
+    snapshot->height = h;
+    snapshot->version = m_topologyVersion;
+    snapshot->walkable.resize(w * h);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            signed char& cell = m_walkableCells[y * w + x];
+            if (cell < 0) {
+                cell = canProtesterMoveTo(nullptr, x, y) ? 1 : 0;
+            }
+            snapshot->walkable[y * w + x] = static_cast<unsigned char>(cell);
+        }
+    }
+    m_walkabilitySnapshot = snapshot;
+    return m_walkabilitySnapshot;
+}
+
+// Uses the result of the job submitted on an earlier tick if there is one. A result computed for
+// a different start still refreshes the last known direction, which is what we answer with until
+// a job for the current position comes back.
+bool StudentWorld::queryPathAsync(PathRequest& request, PathCache::QueryKind kind, int startX, int startY, int endX, int endY,
+                                  int maxSteps, Actor::Direction& firstStep) {
+    PathService::Result result;
+    if (request.pendingTicket != 0 && m_pathService->takeResult(request.pendingTicket, result)) {
+        request.pendingTicket = 0;
+        request.lastDirection = (result.firstStep >= 0 ? PATH_DIRS[result.firstStep] : Actor::none);
+        if (result.startX == startX && result.startY == startY && result.endX == endX && result.endY == endY &&
+            result.maxSteps == maxSteps) {
+            if (result.version == m_topologyVersion) {
+                int limit = (kind == PathCache::BOUNDED ? maxSteps : 0);
+                int value = (kind == PathCache::BOUNDED && result.firstStep < 0 ? -1 : request.lastDirection);
+                m_pathCache.store(makePathCacheKey(kind, startX, startY, endX, endY, limit), value);
             }
+            firstStep = request.lastDirection;
+            return result.firstStep >= 0;
+        }
+    }
+    if (request.pendingTicket == 0) {
+        request.pendingTicket = m_pathService->submit(getWalkabilitySnapshot(), startX, startY, endX, endY, maxSteps);
+    }
+    if (kind == PathCache::BOUNDED) {
+        return false;
+    }
+    firstStep = request.lastDirection;
+    return firstStep != Actor::none;
+}
+
+void StudentWorld::bumpTopologyVersion() {
+    ++m_topologyVersion;
+}
+
+void StudentWorld::topologyChangedAt(int minX, int minY, int maxX, int maxY) {
+    bumpTopologyVersion();
+
+    const int w = OIL_FIELD_WIDTH - SPRITE_WIDTH + 1;
+    const int h = GAME_BOARD_HEIGHT - SPRITE_HEIGHT + 1;
+    for (int y = std::max(minY, 0); y <= std::min(maxY, h - 1); ++y) {
+        for (int x = std::max(minX, 0); x <= std::min(maxX, w - 1); ++x) {
+            m_walkableCells[y * w + x] = -1;
+        }
+    }
+}
+
+// Protesters may not come within 3.0 of a boulder, so a boulder affects the positions around it.
+void StudentWorld::boulderMoved(int fromX, int fromY, int toX, int toY) {
+    rebuildBoulderMasks();
+    topologyChangedAt(std::min(fromX, toX) - 3, std::min(fromY, toY) - 3, std::max(fromX, toX) + 3, std::max(fromY, toY) + 3);
+}
+
+void StudentWorld::boulderRemoved(int x, int y) {
+    rebuildBoulderMasks();
+    topologyChangedAt(x - 3, y - 3, x + 3, y + 3);
+}
+
+void StudentWorld::beginPathQuery() {
+    m_lastPathNodesExpanded = 0;
+    ++m_pathQueryCount;
+}
+
+void StudentWorld::endPathQuery() {
+    m_totalPathNodesExpanded += m_lastPathNodesExpanded;
+    m_pathScheduler.charge(m_lastPathNodesExpanded);
+}
+
+Actor::Direction StudentWorld::answerPathRequest(PathRequest* request, Actor::Direction dir) {
+    if (request) {
+        request->deferred = false;
+        request->lastDirection = dir;
+    }
+    return dir;
+}
+
+Actor::Direction StudentWorld::getPathToCoordinate(int startX, int startY, int endX, int endY, PathRequest* request) {
+    if (!isPathCoordinateInBounds(startX, startY) || !isPathCoordinateInBounds(endX, endY)) return Actor::none;
+
+    PathCache::Key key = makePathCacheKey(PathCache::FIRST_STEP, startX, startY, endX, endY, 0);
+    int cached;
+    if (m_pathCache.lookup(key, cached)) return answerPathRequest(request, static_cast<Actor::Direction>(cached));
+    if (request && m_pathService) {
+        Actor::Direction dir;
+        queryPathAsync(*request, PathCache::FIRST_STEP, startX, startY, endX, endY, MAX_PATH_SEARCH_DEPTH + 1, dir);
+        return dir;
+    }
+    if (request && !m_pathScheduler.admit(*request)) return request->lastDirection;
+
+    beginPathQuery();
+    int firstStepIndex = -1;
+    int length = findPathLength(startX, startY, endX, endY, MAX_PATH_SEARCH_DEPTH + 1, &firstStepIndex);
+
+    // A* may settle on any of several equal-cost paths. The breadth-first search this replaces always
+    // took the first direction in up/down/left/right order that lies on a shortest path, so check the
+    // directions that come before the one A* found.
+    for (int i = 0; length > 0 && i < firstStepIndex; ++i) {
+        int nextX = startX + PATH_DX[i];
+        int nextY = startY + PATH_DY[i];
+        if (isPathCoordinateInBounds(nextX, nextY) && canProtesterMoveTo(nullptr, nextX, nextY) &&
+            findPathLength(nextX, nextY, endX, endY, length - 1, nullptr) == length - 1) {
+            firstStepIndex = i;
+            break;
         }
     }
-    return Actor::none;
+    endPathQuery();
+
+    Actor::Direction result = (length <= 0 ? Actor::none : PATH_DIRS[firstStepIndex]);
+    m_pathCache.store(key, result);
+    return answerPathRequest(request, result);
 }
 
-Actor::Direction StudentWorld::getPathToExit(int startX, int startY) {
-    return getPathToCoordinate(startX, startY, 60, 60);
+Actor::Direction StudentWorld::getPathToExit(int startX, int startY, PathRequest* request) {
+    return getPathToCoordinate(startX, startY, 60, 60, request);
 }
 
 int StudentWorld::getPathDistanceToCoordinate(int startX, int startY, int endX, int endY){
-    std::queue<PathfindingNode> q;
-    std::vector<std::vector<int>> distGrid(OIL_FIELD_WIDTH, std::vector<int>(GAME_BOARD_HEIGHT, -1));
+    if (!isPathCoordinateInBounds(startX, startY) || !isPathCoordinateInBounds(endX, endY)) return 9999;
 
-    if(startX < 0 || startX >= OIL_FIELD_WIDTH || startY < 0 || startY >= GAME_BOARD_HEIGHT ||
-       endX < 0 || endX >= OIL_FIELD_WIDTH || endY < 0 || endY >= GAME_BOARD_HEIGHT) return 9999;
+    PathCache::Key key = makePathCacheKey(PathCache::DISTANCE, startX, startY, endX, endY, 0);
+    int cached;
+    if (m_pathCache.lookup(key, cached)) return cached;
 
+    beginPathQuery();
+    int length = findPathLength(startX, startY, endX, endY, MAX_PATH_SEARCH_DEPTH + 1, nullptr);
+    endPathQuery();
 
-    q.push({startX, startY, 0, Actor::none, {}});
-    distGrid[startX][startY] = 0;
+    int result = (length < 0 ? 9999 : length);
+    m_pathCache.store(key, result);
+    return result;
+}
 
-    int dx_m[] = {0, 0, -1, 1};
-    int dy_m[] = {1, -1, 0, 0};
+bool StudentWorld::isWithinPathDistance(int startX, int startY, int endX, int endY, int maxSteps, Actor::Direction& firstStep,
+                                        PathRequest* request) {
+    firstStep = Actor::none;
+    if (!isPathCoordinateInBounds(startX, startY) || !isPathCoordinateInBounds(endX, endY)) return false;
 
-    while (!q.empty()) {
-        PathfindingNode curr = q.front();
-        q.pop();
+    maxSteps = std::min(maxSteps, MAX_PATH_SEARCH_DEPTH + 1);
+    if (manhattan(startX, startY, endX, endY) > maxSteps) return false;
+    if (startX == endX && startY == endY) return true;
 
-        if (curr.x == endX && curr.y == endY) {
-            return curr.dist;
+    PathCache::Key key = makePathCacheKey(PathCache::BOUNDED, startX, startY, endX, endY, maxSteps);
+    int cached;
+    if (m_pathCache.lookup(key, cached)) {
+        if (cached < 0) return false;
+        firstStep = answerPathRequest(request, static_cast<Actor::Direction>(cached));
+        return true;
+    }
+    if (request && m_pathService) {
+        return queryPathAsync(*request, PathCache::BOUNDED, startX, startY, endX, endY, maxSteps, firstStep);
+    }
+    // A bounded query that has to wait is "not within range" this tick; an old direction could
+    // send the protester after a TunnelMan who is no longer that close.
+    if (request && !m_pathScheduler.admit(*request)) {
+        return false;
+    }
+
+    int dist[OIL_FIELD_WIDTH][GAME_BOARD_HEIGHT];
+    int firstStepIndex[OIL_FIELD_WIDTH][GAME_BOARD_HEIGHT];
+    int queueX[OIL_FIELD_WIDTH * GAME_BOARD_HEIGHT];
+    int queueY[OIL_FIELD_WIDTH * GAME_BOARD_HEIGHT];
+
+    for (int i = 0; i < OIL_FIELD_WIDTH; ++i) {
+        for (int j = 0; j < GAME_BOARD_HEIGHT; ++j) {
+            dist[i][j] = -1;
         }
+    }
 
-        if(curr.dist > 200) continue;
+    beginPathQuery();
+    int head = 0, tail = 0;
+    queueX[tail] = startX;
+    queueY[tail] = startY;
+    ++tail;
+    dist[startX][startY] = 0;
+    firstStepIndex[startX][startY] = -1;
+
+    // Breadth-first in up/down/left/right order, so the first step agrees with getPathToCoordinate.
+    bool found = false;
+    while (head < tail && !found) {
+        int x = queueX[head];
+        int y = queueY[head];
+        ++head;
+
+        int d = dist[x][y];
+        if (d >= maxSteps) break;
+        ++m_lastPathNodesExpanded;
 
         for (int i = 0; i < 4; ++i) {
-            int nextX = curr.x + dx_m[i];
-            int nextY = curr.y + dy_m[i];
-
-            if (nextX >= 0 && nextX < OIL_FIELD_WIDTH && nextY >= 0 && nextY < GAME_BOARD_HEIGHT) {
-                 if (canProtesterMoveTo(nullptr, nextX, nextY) && distGrid[nextX][nextY] == -1) {
-                    distGrid[nextX][nextY] = curr.dist + 1;
-                    q.push({nextX, nextY, curr.dist + 1, Actor::none, {}});
-                }
+            int nextX = x + PATH_DX[i];
+            int nextY = y + PATH_DY[i];
+            if (!isPathCoordinateInBounds(nextX, nextY) || dist[nextX][nextY] != -1) continue;
+            if (manhattan(nextX, nextY, endX, endY) > maxSteps - d - 1) continue;
+            if (!canProtesterMoveTo(nullptr, nextX, nextY)) continue;
+
+            dist[nextX][nextY] = d + 1;
+            firstStepIndex[nextX][nextY] = (d == 0 ? i : firstStepIndex[x][y]);
+            if (nextX == endX && nextY == endY) {
+                firstStep = PATH_DIRS[firstStepIndex[nextX][nextY]];
+                found = true;
+                break;
             }
+            queueX[tail] = nextX;
+            queueY[tail] = nextY;
+            ++tail;
         }
     }
-    return 9999;
+    endPathQuery();
+
+    m_pathCache.store(key, found ? static_cast<int>(firstStep) : -1);
+    if (found) answerPathRequest(request, firstStep);
+    return found;
 }
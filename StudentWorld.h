@@ -3,9 +3,17 @@
 
 #include "GameWorld.h"
 #include "Actor.h"
+#include "PathCache.h"
+#include "PathScheduler.h"
+#include "PathService.h"
+#include "LevelGenerator.h"
+#include "RandomGenerator.h"
+#include "RewindBuffer.h"
 #include <vector>
 #include <string>
 #include <list>
+#include <memory>
+#include <future>
 
 const int OIL_FIELD_WIDTH = 64;
 const int EARTH_FIELD_HEIGHT = 60;
@@ -16,6 +24,8 @@ const int TUNNEL_SHAFT_X_END = 33;
 const int TUNNEL_SHAFT_Y_TOP = 59;
 const int TUNNEL_SHAFT_Y_BOTTOM_NO_EARTH = 4;
 
+const int BLOCKER_MASK_LINES = 64;
+
 class StudentWorld : public GameWorld {
 public:
     StudentWorld(std::string assetPath);
@@ -24,36 +34,124 @@ public:
     virtual int init();
     virtual int move();
     virtual void cleanUp();
+    // Starts building the next level's layout on a worker thread; init() picks it up.
+    virtual void prepareNextLevel();
+    virtual void setRandomSeed(unsigned long long seed);
+    virtual bool rewindOneTick();
+
+    // Everything move() depends on between ticks: counters, earth, TunnelMan, the actor list in
+    // order, the path cache entries that can still match and the generator. A world that reads a
+    // snapshot plays on exactly like the one that wrote it (with async pathfinding, jobs in flight
+    // are dropped and resubmitted). On a malformed snapshot readSnapshot() returns false and
+    // leaves the level cleaned up. Save files and replay keyframes embed this layout; changing it
+    // means bumping SAVE_GAME_FORMAT_VERSION and Replay::FORMAT_VERSION.
+    void writeSnapshot(ByteWriter& out) const;
+    bool readSnapshot(ByteReader& in);
+
+    // 64-bit digest of the earth field, TunnelMan and his inventory, every actor's position,
+    // direction, visibility, life and hit points, the boulder and goodie timers, each protester's
+    // rest, move, turn and shout counters and path request state, the level counters (protester
+    // target and count included) and the generator. The earth and actor parts are running sums
+    // kept up to date as cells and actors change, so reading the hash costs a handful of
+    // multiplies whatever the size of the level.
+    unsigned long long getStateHash() const;
+    void actorHashChanged(unsigned long long termBefore, unsigned long long termAfter) { m_actorHash += termAfter - termBefore; }
+    // Recomputes the actor part of the hash from scratch and compares it with the running sum.
+    // Walks every actor, so it is meant for assert() only.
+    bool actorHashIsConsistent() const;
+
+    // An independent copy for search: same state, and the same future given the same keys. The
+    // copy keeps its earth in bitmasks only, with no Earth sprites, has no input, sound or status
+    // hooked up, and shares this world's read-only walkability snapshot; everything that can
+    // change is copied. Async pathfinding is not carried over.
+    StudentWorld* clone() const;
+
+    // With a budget, move() first records the world's snapshot so rewindOneTick() can step back
+    // through the latest ticks of the current life; cleanUp() forgets them. Off (0) by default;
+    // the windowed game turns it on with RewindBuffer::DEFAULT_BUDGET_BYTES. The recorded states
+    // leave out the path cache, whose reordering on every hit would swamp the deltas, so a
+    // rewound world starts with an empty cache. Under a tight path budget it may defer a search
+    // the first pass did not; everything else comes back exactly.
+    void setRewindBudget(std::size_t budgetBytes) { m_rewind.setBudget(budgetBytes); }
+    const RewindBuffer& getRewindBuffer() const { return m_rewind; }
+
+    // All gameplay randomness (placement, spawns, goodies, protester wandering) comes from here.
+    RandomGenerator& getRandom() { return m_random; }
 
     bool removeEarth(int x, int y);
     bool isEarthAt(int x, int y) const;
     bool isEarthBelowBoulder(int x_boulder_left, int y_boulder_bottom) const;
     bool isEarthUnderneath4x4(int x_topLeft, int y_topLeft) const;
 
-    bool isBoulderAtLocation(int x, int y, double checkRadius) const;
+    bool isBoulderAtLocation(int x, int y, int checkRadius) const;
     bool isBoulderBlockingTunnelMan(int targetManX, int targetManY) const;
 
     bool canSquirtExistAt(int x, int y) const;
 
     void addActor(Actor* actor);
     TunnelMan* getTunnelMan() const { return m_tunnelman; }
-    void revealNearbyObjects(int centerX, int centerY, double radius);
-    bool annoyProtestersInRadius(Actor* instigator, int centerX, int centerY, double radius, int damage);
-    void damageActorsInRadius(Actor* instigatorBoulder, int centerX, int centerY, double radius, int damage);
+    const std::list<Actor*>& getActors() const { return m_actors; }
+    // Bit y of column x is set where there is earth.
+    const unsigned long long* getEarthColumns() const { return m_earthColumns; }
+    void revealNearbyObjects(int centerX, int centerY, int radius);
+    bool annoyProtestersInRadius(Actor* instigator, int centerX, int centerY, int radius, int damage);
+    void damageActorsInRadius(Actor* instigatorBoulder, int centerX, int centerY, int radius, int damage);
     bool checkAndHandleProtesterGoldPickup(Gold* nugget, int goldX, int goldY);
     bool wasAnnoyanceSourceBoulder(Actor* annoyedActor) const;
 
     void decrementBarrelsRemaining();
+    int getBarrelsRemaining() const { return m_barrelsRemaining; }
+    int getProtestersOnField() const { return m_currentNumberOfProtestersOnField; }
 
     bool canProtesterMoveTo(const Protester* protester, int targetX, int targetY) const;
     bool hasClearPathToTunnelMan(const Protester* protester, int startX, int startY, Actor::Direction dir, int& dx_to_tm, int& dy_to_tm, int& path_dist) const;
-    Actor::Direction getPathToExit(int startX, int startY);
-    Actor::Direction getPathToCoordinate(int startX, int startY, int endX, int endY);
+    // Passing a PathRequest lets the per-tick scheduler defer the search; a deferred query answers
+    // with the request's last known direction, except isWithinPathDistance(), which answers false.
+    // Use a separate request for each kind of query.
+    Actor::Direction getPathToExit(int startX, int startY, PathRequest* request = nullptr);
+    Actor::Direction getPathToCoordinate(int startX, int startY, int endX, int endY, PathRequest* request = nullptr);
     int getPathDistanceToCoordinate(int startX, int startY, int endX, int endY);
-    double distance(int x1, int y1, int x2, int y2) const;
+    // True if (endX, endY) is at most maxSteps legal moves away; the search stops expanding at that depth.
+    bool isWithinPathDistance(int startX, int startY, int endX, int endY, int maxSteps, Actor::Direction& firstStep,
+                              PathRequest* request = nullptr);
+
+    unsigned long getPathQueryCount() const { return m_pathQueryCount; }
+    int getLastPathNodesExpanded() const { return m_lastPathNodesExpanded; }
+    unsigned long getTotalPathNodesExpanded() const { return m_totalPathNodesExpanded; }
+
+    // Wall time spent placing objects for the current level, in microseconds.
+    long long getLastLevelGenerationMicros() const { return m_lastLevelGenerationMicros; }
+
+    // When on (the default), cleanUp() keeps TunnelMan and every Earth cell around and the next
+    // init() re-shows what the new level needs instead of deleting and reallocating the field.
+    void setInPlaceReset(bool enabled);
+    bool isInPlaceReset() const { return m_inPlaceReset; }
+    // Time from the start of the last cleanUp() to the end of the following init(), in microseconds.
+    long long getLastResetMicros() const { return m_lastResetMicros; }
+
+    // Bumped whenever earth is removed or a boulder moves; cached path results are keyed by it.
+    unsigned long getTopologyVersion() const { return m_topologyVersion; }
+    void boulderMoved(int fromX, int fromY, int toX, int toY);
+    void boulderRemoved(int x, int y);
+    const PathCache& getPathCache() const { return m_pathCache; }
+    PathScheduler& getPathScheduler() { return m_pathScheduler; }
+
+    // Protester path queries go to worker threads and are answered on the following tick.
+    void setAsyncPathfinding(bool enabled, int threadCount = 0);
+    bool isAsyncPathfinding() const { return m_pathService != nullptr; }
+    void releasePathRequest(PathRequest& request);
 
 private:
     Earth* m_earth[OIL_FIELD_WIDTH][EARTH_FIELD_HEIGHT];
+    Earth* m_earthStorage[OIL_FIELD_WIDTH][EARTH_FIELD_HEIGHT];
+
+    // One bit per cell, indexed both by row (bit = x) and by column (bit = y), for straight-line tests.
+    unsigned long long m_earthRows[BLOCKER_MASK_LINES];
+    unsigned long long m_earthColumns[BLOCKER_MASK_LINES];
+    unsigned long long m_boulderRows[BLOCKER_MASK_LINES];
+    unsigned long long m_boulderColumns[BLOCKER_MASK_LINES];
+    unsigned long long m_earthHash;    // XOR of zobristKey() over the cells with earth
+    unsigned long long m_actorHash;    // sum of getStateHashTerm() over TunnelMan and m_actors
     TunnelMan* m_tunnelman;
     std::list<Actor*> m_actors;
 
@@ -64,11 +162,68 @@ private:
 
     Actor* m_lastAnnoyanceSource;
 
-    void populateOilFieldWithObjects();
+    unsigned long m_pathQueryCount;
+    int m_lastPathNodesExpanded;
+    unsigned long m_totalPathNodesExpanded;
+    long long m_lastLevelGenerationMicros;
+    bool m_inPlaceReset;
+    bool m_earthSprites;    // false in clones: earth is tracked by the bitmasks alone
+    long long m_lastCleanUpMicros;
+    long long m_lastResetMicros;
+    std::future<LevelLayout> m_nextLayout;
+    RandomGenerator m_random;
+
+    unsigned long m_topologyVersion;
+    PathCache m_pathCache;
+    PathScheduler m_pathScheduler;
+    std::vector<signed char> m_walkableCells;
+    std::shared_ptr<const WalkabilitySnapshot> m_walkabilitySnapshot;
+    std::unique_ptr<PathService> m_pathService;
+    RewindBuffer m_rewind;
+
+    // Live protesters in insertion order, with scratch arrays for the batched radius test.
+    std::vector<Protester*> m_protesters;
+    std::vector<int> m_protesterX;
+    std::vector<int> m_protesterY;
+    std::vector<unsigned long long> m_protesterHits;
+
+    // Used by clone(): copies everything mutable without building the defaults first. Of the path
+    // cache only the entries that can still match are copied.
+    StudentWorld(const StudentWorld& other);
+    StudentWorld& operator=(const StudentWorld&);
+
+    LevelLayout takeLevelLayout();
+    void populateOilFieldWithObjects(const LevelLayout& layout);
+    void placeEarth(int x, int y);
+    void releaseEarth(int x, int y);
+    void releaseEarthStorage();
+    bool readActor(ByteReader& in, Actor*& actor);
+    // writeSnapshot(), with an empty path cache in place of the real one if asked.
+    void writeState(ByteWriter& out, bool withPathCache) const;
+    void deleteActors();
     void removeDeadActors();
     void addNewActorsDuringTick();
     void updateGameStatText();
-    bool isAnyObjectNearby(int x, int y, double radius, bool checkOnlyBoulders) const;
+    bool isAnyObjectNearby(int x, int y, int radius, bool checkOnlyBoulders) const;
+
+    bool isLineRangeBlocked(const unsigned long long lines[], int first, int last, int lo, int hi) const;
+    void setEarthMaskBit(int x, int y, bool present);
+    void rebuildBoulderMasks();
+
+    int findProtestersInRadius(int centerX, int centerY, int radius);
+    bool isProtesterHit(int index) const;
+
+    bool isPathCoordinateInBounds(int x, int y) const;
+    int findPathLength(int startX, int startY, int endX, int endY, int maxLength, int* firstStepIndex);
+    PathCache::Key makePathCacheKey(PathCache::QueryKind kind, int startX, int startY, int endX, int endY, int limit) const;
+    void bumpTopologyVersion();
+    void topologyChangedAt(int minX, int minY, int maxX, int maxY);
+    void beginPathQuery();
+    void endPathQuery();
+    Actor::Direction answerPathRequest(PathRequest* request, Actor::Direction dir);
+    std::shared_ptr<const WalkabilitySnapshot> getWalkabilitySnapshot();
+    bool queryPathAsync(PathRequest& request, PathCache::QueryKind kind, int startX, int startY, int endX, int endY,
+                        int maxSteps, Actor::Direction& firstStep);
 
 };
 
@@ -0,0 +1,195 @@
+#include "VectorEnv.h"
+#include "GameConstants.h"
+#include <algorithm>
+using namespace std;
+
+namespace {
+    const int ACTION_KEYS[] = { 0, KEY_PRESS_LEFT, KEY_PRESS_RIGHT, KEY_PRESS_UP, KEY_PRESS_DOWN,
+                                KEY_PRESS_SPACE, KEY_PRESS_TAB, 'z' };
+}
+
+bool VectorEnv::Env::getLastKey(int& value) {
+    if (!keyPending) {
+        return false;
+    }
+    keyPending = false;
+    value = key;
+    return true;
+}
+
+VectorEnv::VectorEnv(const VectorEnvOptions& options)
+    : m_options(options), m_started(false), m_generation(0), m_busyWorkers(0), m_stopping(false), m_nextEnv(0),
+      m_actions(nullptr), m_out() {
+    int envs = max(1, options.envs);
+    for (int i = 0; i < envs; ++i) {
+        m_envs.push_back(unique_ptr<Env>(new Env()));
+        m_envs.back()->seed = options.seed + i;
+        m_envs.back()->world.setInputSource(m_envs.back().get());
+    }
+
+    int threads = options.threads;
+    if (threads <= 0) {
+        threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    }
+    threads = min(threads, envs);
+    for (int i = 1; i < threads; ++i) {
+        m_workers.push_back(thread(&VectorEnv::workerLoop, this));
+    }
+}
+
+VectorEnv::~VectorEnv() {
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_workReady.notify_all();
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+        m_workers[i].join();
+    }
+}
+
+unsigned long VectorEnv::getEpisodesFinished() const {
+    unsigned long total = 0;
+    for (const unique_ptr<Env>& env : m_envs) {
+        total += env->episodesFinished;
+    }
+    return total;
+}
+
+void VectorEnv::reset(float* observations, unsigned char* grids) {
+    for (size_t i = 0; i < m_envs.size(); ++i) {
+        Env& env = *m_envs[i];
+        if (m_started) {
+            env.seed += m_envs.size();
+        }
+        startEpisode(env);
+        writeObservation(env, observations + i * OBSERVATION_SIZE,
+                         grids ? grids + i * ObservationWriter::OBSERVATION_BYTES : nullptr);
+    }
+    m_started = true;
+}
+
+// The caller's thread works alongside the pool; worlds are claimed one at a time, so a world
+// that is resetting does not hold up a whole slice.
+void VectorEnv::step(const int* actions, const VectorStep& out) {
+    m_actions = actions;
+    m_out = out;
+    m_nextEnv = 0;
+    if (!m_workers.empty()) {
+        {
+            lock_guard<mutex> lock(m_mutex);
+            ++m_generation;
+            m_busyWorkers = static_cast<int>(m_workers.size());
+        }
+        m_workReady.notify_all();
+    }
+    stepClaimedEnvs();
+    if (!m_workers.empty()) {
+        unique_lock<mutex> lock(m_mutex);
+        m_workDone.wait(lock, [this] { return m_busyWorkers == 0; });
+    }
+}
+
+void VectorEnv::workerLoop() {
+    unsigned long seen = 0;
+    for (;;) {
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_workReady.wait(lock, [this, seen] { return m_stopping || m_generation != seen; });
+            if (m_stopping) {
+                return;
+            }
+            seen = m_generation;
+        }
+        stepClaimedEnvs();
+        {
+            lock_guard<mutex> lock(m_mutex);
+            if (--m_busyWorkers == 0) {
+                m_workDone.notify_one();
+            }
+        }
+    }
+}
+
+void VectorEnv::stepClaimedEnvs() {
+    int count = static_cast<int>(m_envs.size());
+    for (int index = m_nextEnv++; index < count; index = m_nextEnv++) {
+        stepEnv(index);
+    }
+}
+
+// One tick the way HeadlessDriver plays it, minus the background level generation: the next
+// layout is built inside init() on this thread.
+void VectorEnv::stepEnv(int index) {
+    Env& env = *m_envs[index];
+    StudentWorld& world = env.world;
+    int action = m_actions[index];
+    if (action > ACTION_NONE && action < NUM_ACTIONS) {
+        env.key = ACTION_KEYS[action];
+        env.keyPending = true;
+    }
+
+    unsigned int scoreBefore = world.getScore();
+    int status = world.move();
+    world.advanceTick();
+    env.keyPending = false;
+    env.episodeTicks++;
+    m_out.rewards[index] = static_cast<float>(world.getScore() - scoreBefore);
+    m_out.statuses[index] = status;
+
+    bool done = false;
+    if (status == GWSTATUS_PLAYER_DIED && world.isGameOver()) {
+        done = true;
+    } else if (status != GWSTATUS_CONTINUE_GAME) {
+        if (status == GWSTATUS_FINISHED_LEVEL) {
+            world.advanceToNextLevel();
+        }
+        world.cleanUp();
+        done = world.init() != GWSTATUS_CONTINUE_GAME;
+    }
+    if (m_options.maxTicksPerEpisode > 0 && env.episodeTicks >= m_options.maxTicksPerEpisode) {
+        done = true;
+    }
+    if (done) {
+        env.episodesFinished++;
+        env.seed += m_envs.size();
+        startEpisode(env);
+    }
+    m_out.dones[index] = done ? 1 : 0;
+    writeObservation(env, m_out.observations + index * OBSERVATION_SIZE,
+                     m_out.grids ? m_out.grids + index * ObservationWriter::OBSERVATION_BYTES : nullptr);
+}
+
+// Reuses the world: cleanUp() keeps the field for the next init(), as between levels.
+void VectorEnv::startEpisode(Env& env) {
+    env.world.cleanUp();
+    env.world.restoreCounters(START_PLAYER_LIVES, 0, 0, 0);
+    env.world.setRandomSeed(env.seed);
+    env.world.init();
+    env.keyPending = false;
+    env.episodeTicks = 0;
+}
+
+void VectorEnv::writeObservation(Env& env, float* observation, unsigned char* grid) {
+    const StudentWorld& world = env.world;
+    const TunnelMan* tunnelman = world.getTunnelMan();
+    observation[0] = static_cast<float>(tunnelman->getX());
+    observation[1] = static_cast<float>(tunnelman->getY());
+    observation[2] = static_cast<float>(tunnelman->getDirection());
+    observation[3] = static_cast<float>(tunnelman->getHP());
+    observation[4] = static_cast<float>(tunnelman->getWaterCount());
+    observation[5] = static_cast<float>(tunnelman->getGoldCount());
+    observation[6] = static_cast<float>(tunnelman->getSonarCount());
+    observation[7] = static_cast<float>(world.getBarrelsRemaining());
+    observation[8] = static_cast<float>(world.getLives());
+    observation[9] = static_cast<float>(world.getLevel());
+    observation[10] = static_cast<float>(world.getProtestersOnField());
+    observation[11] = static_cast<float>(env.episodeTicks);
+
+    if (grid != nullptr) {
+        if (env.gridWriter.getGrid() != grid) {
+            env.gridWriter.setGrid(grid);
+        }
+        env.gridWriter.write(world);
+    }
+}
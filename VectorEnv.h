@@ -0,0 +1,105 @@
+#ifndef VECTORENV_H_
+#define VECTORENV_H_
+
+#include "StudentWorld.h"
+#include "ObservationWriter.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct VectorEnvOptions {
+    VectorEnvOptions() : envs(1), threads(1), seed(0), maxTicksPerEpisode(0) {}
+
+    int envs;
+    int threads;                        // 0 uses one per hardware thread; 1 steps on the caller's thread
+    unsigned long long seed;            // world i starts with seed + i; each new episode adds envs
+    unsigned long maxTicksPerEpisode;   // 0 lets every episode run until the game is over
+};
+
+// Caller-owned outputs of VectorEnv::step(), one entry per world (observations holds
+// OBSERVATION_SIZE floats per world, world i's starting at i * OBSERVATION_SIZE).
+struct VectorStep {
+    float* rewards;                 // score gained this tick
+    int* statuses;                  // what move() returned, a GWSTATUS_* code
+    unsigned char* dones;           // 1 if the episode ended and the world was reset
+    float* observations;
+    unsigned char* grids;           // ObservationWriter::OBSERVATION_BYTES per world, or nullptr
+};
+
+// Steps many StudentWorlds in lockstep for training bots: one call takes an action per world
+// and advances every world by one tick. Deaths and finished levels are played through the way
+// the framework would, and a world whose game is over (or whose episode hit the tick limit)
+// starts its next episode at once, so one long episode never holds the rest back. The
+// observation after a done is the new episode's first. Results never depend on the thread count.
+class VectorEnv {
+public:
+    enum Action {
+        ACTION_NONE, ACTION_LEFT, ACTION_RIGHT, ACTION_UP, ACTION_DOWN,
+        ACTION_SQUIRT, ACTION_DROP_GOLD, ACTION_SONAR,
+        NUM_ACTIONS
+    };
+
+    // TunnelMan's x, y, direction, hit points, water, gold and sonar; barrels left, lives, level,
+    // protesters on the field and ticks into the episode.
+    static const int OBSERVATION_SIZE = 12;
+
+    explicit VectorEnv(const VectorEnvOptions& options);
+    ~VectorEnv();
+
+    int getEnvCount() const { return static_cast<int>(m_envs.size()); }
+    int getThreadCount() const { return static_cast<int>(m_workers.size()) + 1; }
+
+    // Starts a new episode in every world; call once before the first step().
+    void reset(float* observations, unsigned char* grids = nullptr);
+    // actions[i] (an Action; anything else counts as ACTION_NONE) drives world i.
+    void step(const int* actions, const VectorStep& out);
+
+    StudentWorld& getWorld(int env) { return m_envs[env]->world; }
+    unsigned long getEpisodesFinished() const;
+
+private:
+    class Env : public InputSource {
+    public:
+        Env() : world(""), keyPending(false), key(0), seed(0), episodeTicks(0), episodesFinished(0) {}
+
+        virtual bool getLastKey(int& value) override;
+
+        StudentWorld world;
+        bool keyPending;
+        int key;
+        unsigned long long seed;
+        unsigned long episodeTicks;
+        unsigned long episodesFinished;
+        ObservationWriter gridWriter;   // kept per world so grids are updated, not redrawn
+    };
+
+    VectorEnvOptions m_options;
+    std::vector<std::unique_ptr<Env> > m_envs;
+    bool m_started;
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_workReady;
+    std::condition_variable m_workDone;
+    unsigned long m_generation;
+    int m_busyWorkers;
+    bool m_stopping;
+    std::atomic<int> m_nextEnv;
+    const int* m_actions;
+    VectorStep m_out;
+
+    void workerLoop();
+    void stepClaimedEnvs();
+    void stepEnv(int index);
+    void startEpisode(Env& env);
+    void writeObservation(Env& env, float* observation, unsigned char* grid);
+
+    VectorEnv(const VectorEnv&);
+    VectorEnv& operator=(const VectorEnv&);
+};
+
+#endif // VECTORENV_H_
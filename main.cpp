@@ -1,11 +1,355 @@
+#if defined(TUNNELMAN_HEADLESS)
+#include "BatchRunner.h"
+#include "ObservationWriter.h"
+#include "Replay.h"
+#include "SaveGame.h"
+#include "StudentWorld.h"
+#include "VectorEnv.h"
+#else
 #include "GameController.h"
+#endif
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
 #include <cstdlib>
 #include <ctime>
+#include <chrono>
+#include <cstring>
 using namespace std;
 
+#if defined(TUNNELMAN_HEADLESS)
+
+  // Headless build: plays games with scripted random keys on a pool of
+  // threads and reports throughput instead of opening a window.
+  //   usage: TunnelMan [games] [maxTicksPerGame] [seed] [threads]
+  //          TunnelMan record <file> [maxTicks] [seed] [keyframeInterval] [checksumInterval]
+  //          TunnelMan replay <file> [seekTick]
+  //          TunnelMan save <file> [ticks] [seed]
+  //          TunnelMan load <file> [maxTicks] [seed]
+  //          TunnelMan clone [ticks] [seed] [count]
+  //          TunnelMan vecenv [envs] [steps] [seed] [threads]
+  //          TunnelMan observe [maxTicks] [seed]
+
+static void printGame(const DriverStats& stats)
+{
+	cout << stats.ticks << " ticks, level " << stats.finalLevel << ", score " << stats.finalScore
+		 << ", " << stats.ticksPerSecond() << " ticks/s" << endl;
+}
+
+static int recordGame(string path, unsigned long maxTicks, unsigned long long seed, unsigned long keyframeInterval,
+					  unsigned long checksumInterval)
+{
+	StudentWorld world("");
+	world.setRandomSeed(seed);
+	ReplayRecorder recorder(seed, keyframeInterval);
+	recorder.setChecksumInterval(checksumInterval);
+	world.setInputRecorder(&recorder);
+	RandomKeyScript script(seed);
+	HeadlessDriver driver(&world, &script);
+	driver.setTickObserver(&recorder);
+	DriverStats stats = driver.run(maxTicks);
+	recorder.finish(world.getTick());
+
+	if (!recorder.getReplay().save(path))
+	{
+		cout << "Cannot write " << path << endl;
+		return 1;
+	}
+	cout << "recorded ";
+	printGame(stats);
+	cout << recorder.getReplay().events.size() << " keys, " << recorder.getReplay().keyframes.size()
+		 << " keyframes, " << recorder.getReplay().checksums.size() << " checksums in "
+		 << recorder.getReplay().encode().size() << " bytes" << endl;
+	return 0;
+}
+
+static int replayGame(string path, bool seek, unsigned long seekTick)
+{
+	Replay replay;
+	if (!replay.load(path))
+	{
+		cout << "Cannot read replay " << path << endl;
+		return 1;
+	}
+	StudentWorld world("");
+	world.setRandomSeed(replay.seed);
+	if (seek)
+	{
+		auto start = chrono::steady_clock::now();
+		if (!seekReplay(replay, world, seekTick))
+		{
+			cout << "No keyframe at or before tick " << seekTick << endl;
+			return 1;
+		}
+		cout << "seeked to tick " << world.getTick() << " in "
+			 << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms, level "
+			 << world.getLevel() << ", score " << world.getScore() << endl;
+		return 0;
+	}
+	ReplayPlayer player(replay);
+	ReplayVerifier verifier(replay);
+	HeadlessDriver driver(&world, &player);
+	driver.setTickObserver(&verifier);
+	DriverStats stats = driver.run(replay.endTick);
+	cout << "replayed ";
+	printGame(stats);
+	if (verifier.hasDiverged())
+	{
+		cout << "diverged from the recording at tick " << verifier.getFirstDivergentTick() << endl;
+		return 1;
+	}
+	if (verifier.getChecked() > 0)
+		cout << verifier.getChecked() << " checksums match" << endl;
+	return 0;
+}
+
+static int saveCheckpoint(string path, unsigned long ticks, unsigned long long seed)
+{
+	StudentWorld world("");
+	world.setRandomSeed(seed);
+	RandomKeyScript script(seed);
+	DriverStats stats = HeadlessDriver(&world, &script).run(ticks);
+	if (world.isGameOver())
+	{
+		cout << "Game ended after " << stats.ticks << " ticks; nothing to save" << endl;
+		return 1;
+	}
+	if (!saveGame(world, path))
+	{
+		cout << "Cannot write " << path << endl;
+		return 1;
+	}
+	cout << "saved at tick " << world.getTick() << " (" << encodeSaveGame(world).size() << " bytes) after ";
+	printGame(stats);
+	return 0;
+}
+
+static int loadCheckpoint(string path, unsigned long maxTicks, unsigned long long seed)
+{
+	StudentWorld world("");
+	auto start = chrono::steady_clock::now();
+	if (!loadGame(path, world))
+	{
+		cout << "Cannot read save " << path << endl;
+		return 1;
+	}
+	cout << "restored tick " << world.getTick() << " in "
+		 << chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() << " us" << endl;
+	RandomKeyScript script(seed);
+	DriverStats stats = HeadlessDriver(&world, &script).resume(maxTicks);
+	cout << "continued ";
+	printGame(stats);
+	return 0;
+}
+
+static int cloneWorld(unsigned long ticks, unsigned long long seed, unsigned long count)
+{
+	StudentWorld world("");
+	world.setRandomSeed(seed);
+	RandomKeyScript script(seed);
+	DriverStats stats = HeadlessDriver(&world, &script).run(ticks);
+	if (world.isGameOver())
+	{
+		cout << "Game ended after " << stats.ticks << " ticks; nothing to clone" << endl;
+		return 1;
+	}
+
+	auto start = chrono::steady_clock::now();
+	for (unsigned long i = 0; i < count; i++)
+		delete world.clone();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cout << count << " clones at tick " << world.getTick() << ": "
+		 << (seconds > 0 ? count / seconds : 0) << " clones/s, " << seconds * 1e6 / (count > 0 ? count : 1)
+		 << " us each" << endl;
+
+	  // the clone must play on exactly like the original given the same keys
+	StudentWorld* copy = world.clone();
+	bool same = copy->getStateHash() == world.getStateHash();
+	{
+		RandomKeyScript originalKeys(seed + 1);
+		RandomKeyScript copyKeys(seed + 1);
+		HeadlessDriver original(&world, &originalKeys);
+		HeadlessDriver cloned(copy, &copyKeys);
+		for (unsigned long tick = 0; same && tick < ticks && !world.isGameOver(); tick++)
+		{
+			original.resume(1);
+			cloned.resume(1);
+			same = copy->getStateHash() == world.getStateHash();
+		}
+	}
+	delete copy;
+	cout << (same ? "clone matches the original" : "clone diverged from the original")
+		 << " through tick " << world.getTick() << endl;
+	return same ? 0 : 1;
+}
+
+static int stepVectorEnv(int envs, unsigned long steps, unsigned long long seed, int threads)
+{
+	VectorEnvOptions options;
+	options.envs = envs;
+	options.threads = threads;
+	options.seed = seed;
+	VectorEnv env(options);
+	int count = env.getEnvCount();
+
+	vector<int> actions(count);
+	vector<float> rewards(count);
+	vector<int> statuses(count);
+	vector<unsigned char> dones(count);
+	vector<float> observations(count * VectorEnv::OBSERVATION_SIZE);
+	VectorStep out = { rewards.data(), statuses.data(), dones.data(), observations.data(), nullptr };
+	RandomGenerator policy(seed);
+	double totalReward = 0;
+
+	env.reset(observations.data());
+	auto start = chrono::steady_clock::now();
+	for (unsigned long step = 0; step < steps; step++)
+	{
+		for (int i = 0; i < count; i++)
+			actions[i] = policy.nextInt(VectorEnv::NUM_ACTIONS);
+		env.step(actions.data(), out);
+		for (int i = 0; i < count; i++)
+			totalReward += rewards[i];
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	cout << count << " worlds x " << steps << " steps on " << env.getThreadCount() << " threads: "
+		 << (seconds > 0 ? count * steps / seconds : 0) << " world-ticks/s, "
+		 << (seconds > 0 ? steps / seconds : 0) << " steps/s" << endl;
+	cout << env.getEpisodesFinished() << " episodes finished, " << totalReward << " total reward" << endl;
+	return 0;
+}
+
+  // Times observation grids written incrementally against grids drawn from scratch, and checks
+  // that the two agree on every tick.
+class ObservationBenchmark : public TickObserver
+{
+  public:
+	ObservationBenchmark()
+	 : m_incrementalGrid(ObservationWriter::OBSERVATION_BYTES), m_fullGrid(ObservationWriter::OBSERVATION_BYTES),
+	   m_incremental(m_incrementalGrid.data()), m_full(m_fullGrid.data()),
+	   m_observations(0), m_mismatches(0), m_incrementalSeconds(0), m_fullSeconds(0), m_cellsWritten(0)
+	{
+	}
+
+	virtual void beforeTick(StudentWorld& world) override
+	{
+		auto start = chrono::steady_clock::now();
+		m_incremental.write(world);
+		auto middle = chrono::steady_clock::now();
+		m_full.invalidate();
+		m_full.write(world);
+		auto end = chrono::steady_clock::now();
+
+		m_incrementalSeconds += chrono::duration<double>(middle - start).count();
+		m_fullSeconds += chrono::duration<double>(end - middle).count();
+		m_cellsWritten += m_incremental.getLastCellsWritten();
+		m_observations++;
+		if (memcmp(m_incrementalGrid.data(), m_fullGrid.data(), m_incrementalGrid.size()) != 0)
+			m_mismatches++;
+	}
+
+	void print() const
+	{
+		cout << m_observations << " observations of " << ObservationWriter::OBSERVATION_BYTES << " bytes" << endl;
+		cout << "incremental: " << (m_incrementalSeconds > 0 ? m_observations / m_incrementalSeconds : 0)
+			 << " observations/s, " << (m_observations > 0 ? m_cellsWritten / m_observations : 0) << " cells/observation" << endl;
+		cout << "from scratch: " << (m_fullSeconds > 0 ? m_observations / m_fullSeconds : 0) << " observations/s" << endl;
+		cout << (m_mismatches == 0 ? "grids agree on every tick" : "grids disagree on some ticks") << endl;
+	}
+
+	bool agrees() const
+	{
+		return m_mismatches == 0;
+	}
+
+  private:
+	vector<unsigned char> m_incrementalGrid;
+	vector<unsigned char> m_fullGrid;
+	ObservationWriter m_incremental;
+	ObservationWriter m_full;
+	unsigned long m_observations;
+	unsigned long m_mismatches;
+	double m_incrementalSeconds;
+	double m_fullSeconds;
+	unsigned long long m_cellsWritten;
+};
+
+static int benchmarkObservations(unsigned long maxTicks, unsigned long long seed)
+{
+	StudentWorld world("");
+	world.setRandomSeed(seed);
+	RandomKeyScript script(seed);
+	ObservationBenchmark benchmark;
+	HeadlessDriver driver(&world, &script);
+	driver.setTickObserver(&benchmark);
+	driver.run(maxTicks);
+	benchmark.print();
+	return benchmark.agrees() ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+	  // every object belongs to its world's registry; nothing should touch the global one
+	GraphObjectRegistry::setGlobalEnabled(false);
+
+	string mode = argc > 1 ? argv[1] : "";
+	if (mode == "record" && argc > 2)
+		return recordGame(argv[2], argc > 3 ? strtoul(argv[3], nullptr, 10) : 0,
+						  argc > 4 ? strtoull(argv[4], nullptr, 10) : static_cast<unsigned long long>(time(nullptr)),
+						  argc > 5 ? strtoul(argv[5], nullptr, 10) : ReplayRecorder::DEFAULT_KEYFRAME_INTERVAL,
+						  argc > 6 ? strtoul(argv[6], nullptr, 10) : 0);
+	if (mode == "save" && argc > 2)
+		return saveCheckpoint(argv[2], argc > 3 ? strtoul(argv[3], nullptr, 10) : 1000,
+							  argc > 4 ? strtoull(argv[4], nullptr, 10) : static_cast<unsigned long long>(time(nullptr)));
+	if (mode == "load" && argc > 2)
+		return loadCheckpoint(argv[2], argc > 3 ? strtoul(argv[3], nullptr, 10) : 0,
+							  argc > 4 ? strtoull(argv[4], nullptr, 10) : static_cast<unsigned long long>(time(nullptr)));
+	if (mode == "clone")
+		return cloneWorld(argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000,
+						  argc > 3 ? strtoull(argv[3], nullptr, 10) : static_cast<unsigned long long>(time(nullptr)),
+						  argc > 4 ? strtoul(argv[4], nullptr, 10) : 10000);
+	if (mode == "vecenv")
+		return stepVectorEnv(argc > 2 ? atoi(argv[2]) : 16, argc > 3 ? strtoul(argv[3], nullptr, 10) : 10000,
+							 argc > 4 ? strtoull(argv[4], nullptr, 10) : static_cast<unsigned long long>(time(nullptr)),
+							 argc > 5 ? atoi(argv[5]) : 0);
+	if (mode == "observe")
+		return benchmarkObservations(argc > 2 ? strtoul(argv[2], nullptr, 10) : 0,
+									 argc > 3 ? strtoull(argv[3], nullptr, 10) : static_cast<unsigned long long>(time(nullptr)));
+	if (mode == "replay" && argc > 2)
+		return replayGame(argv[2], argc > 3, argc > 3 ? strtoul(argv[3], nullptr, 10) : 0);
+
+	BatchOptions options;
+	options.games = argc > 1 ? atoi(argv[1]) : 1;
+	options.maxTicksPerGame = argc > 2 ? strtoul(argv[2], nullptr, 10) : 0;
+	options.seed = argc > 3 ? strtoull(argv[3], nullptr, 10)
+							: static_cast<unsigned long long>(time(nullptr));
+	options.threads = argc > 4 ? atoi(argv[4]) : 0;
+
+	BatchResult result = BatchRunner(options).run();
+	for (size_t g = 0; g < result.games.size(); g++)
+	{
+		cout << "game " << g << ": ";
+		printGame(result.games[g].stats);
+	}
+
+	const DriverStats& total = result.total;
+	cout << "ticks:            " << total.ticks << endl;
+	cout << "wall time:        " << total.wallSeconds << " s (" << result.cpuSeconds << " s in games)" << endl;
+	cout << "ticks/s:          " << total.ticksPerSecond() << endl;
+	cout << "ticks/level:      " << total.ticksPerLevel() << endl;
+	cout << "score:            " << result.meanScore << " avg, " << result.maxScore << " max" << endl;
+	cout << "level:            " << result.meanLevel << " avg, " << result.maxLevel << " max" << endl;
+	cout << "levels completed: " << total.levelsCompleted << ", lives lost: " << total.livesLost << endl;
+	if (total.levelsStarted > 0)
+		cout << "level generation: " << total.totalLevelGenerationMicros / total.levelsStarted << " us avg" << endl;
+	if (total.resets > 0)
+		cout << "reset latency:    " << total.totalResetMicros / total.resets << " us avg" << endl;
+}
+
+#else
+
 const string assetDirectory = "Assets"; 
 
 class GameWorld;
@@ -29,8 +373,9 @@ int main(int argc, char* argv[])
 		}
 	}
 
-	srand(static_cast<unsigned int>(time(nullptr)));
-
 	GameWorld* gw = createStudentWorld(assetDirectory);
+	gw->setRandomSeed(static_cast<unsigned long long>(time(nullptr)));
 	Game().run(argc, argv, gw, "TunnelMan");
 }
+
+#endif // TUNNELMAN_HEADLESS